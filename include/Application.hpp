@@ -2,6 +2,8 @@
 #define APP_H 
 
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
@@ -10,6 +12,19 @@
 #include "Scene.hpp"
 #include "Camera.hpp"
 #include "Shader.hpp"
+#include "UniformBlocks.hpp"
+#include "RenderQueue.hpp"
+#include "TransformStore.hpp"
+#include "RenderList.hpp"
+#include "Water/DynamicResolution.hpp"
+#include "Water/WaterUpdatePolicy.hpp"
+#include "Water/WaterGroup.hpp"
+#include "Profiler.hpp"
+#include "GpuTimer.hpp"
+#include "Surface.hpp"
+#include "CameraPath.hpp"
+#include "SceneStreamer.hpp"
+#include "DeferredRenderer.hpp"
 
 /******** GLFW callbacks ******/
 // need to give glfw free functions as callbacks
@@ -22,11 +37,19 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
 /******** Application class **********/
 
+enum RenderPass {
+    MainPass = 0,
+    ReflectionPass,
+    RefractionPass,
+    NumRenderPasses
+};
+
 class Application
 {
     public:
 
-        Application(unsigned int viewportWidth, unsigned int viewportHeight);
+        /* A headless application renders offscreen, see Surface */
+        Application(unsigned int viewportWidth, unsigned int viewportHeight, bool headless = false);
         ~Application();
 
         bool ready() const;
@@ -36,8 +59,100 @@ class Application
             return _window;
         }
 
+        const Surface* surface() const {
+            return _surface;
+        }
+
         void attachScene(Scene& scene);
         void attachCamera(Camera& camera);
+
+        /* Stop after this many frames (0 = run until the window is closed) */
+        void setFrameLimit(unsigned long frames) {
+            _frameLimit = frames;
+        }
+
+        /* Batch entities sharing a mesh into instanced draws (on by default) */
+        void setInstancing(bool enabled) {
+            _renderQueue.setInstancing(enabled);
+        }
+
+        /* Culling results of the last rendered frame */
+        const CullStats& cullStats(RenderPass pass) const {
+            return _cullStats[pass];
+        }
+
+        /* Frame time the water reflection/refraction resolution is scaled to meet */
+        void setWaterFrameBudget(float ms) {
+            _waterResolution.setFrameBudget(ms);
+        }
+
+        /* When water reflection/refraction textures are re-rendered (every frame by default) */
+        void setWaterUpdatePolicy(const WaterUpdatePolicy& policy) {
+            _waterPolicy = policy;
+        }
+
+        /* Append the camera state and frame time of every frame to path */
+        void recordCameraPath(CameraPath* path) {
+            _recordPath = path;
+        }
+
+        /**
+         * @brief Drive the camera from path instead of input, advancing time by the path's
+         * fixed timestep; the run stops at the end of the path.
+         */
+        void replayCameraPath(const CameraPath* path) {
+            _replayPath = path;
+        }
+
+        /**
+         * @brief Place streamed objects into the attached scene as they finish loading,
+         * spending at most the upload budget on them each frame.
+         */
+        void attachStreamer(SceneStreamer* streamer) {
+            _streamer = streamer;
+        }
+
+        /* Milliseconds per frame spent uploading streamed meshes and textures */
+        void setUploadBudget(float ms) {
+            _uploadBudget = ms;
+        }
+
+        /* Print profiler zone averages every this many seconds while profiling (0 = on exit only) */
+        void setProfileReportInterval(float seconds) {
+            _profileReportInterval = seconds;
+        }
+
+        /**
+         * @brief Screen-space error in pixels a pass accepts when picking levels of detail.
+         * Reflection and refraction default to 2 pixels since the water distorts them.
+         */
+        void setLodBias(RenderPass pass, float pixels) {
+            _lodBias[pass] = pixels;
+        }
+
+        /* Draw every mesh at full detail (for comparisons) */
+        void setLodEnabled(bool enabled) {
+            _lodEnabled = enabled;
+        }
+
+        /**
+         * @brief Shade entities from a G-buffer, lit by every point light of the scene
+         * instead of the first ubo::MaxPointLights (off by default), see DeferredRenderer.
+         */
+        void setDeferred(bool enabled);
+
+        /* Coplanar waters share their reflection and refraction passes, see WaterGroup */
+        size_t waterGroupCount() const {
+            return _waterGroups.size();
+        }
+
+        /* Current resolution scale of water group i's reflection and refraction targets */
+        float waterResolutionScale(size_t group) const {
+            return group < _waterGroups.size() ? _waterGroups[group].scale : 1.0f;
+        }
+
+        /* Re-upload one point light after moving or recoloring it */
+        void updatePointLight(size_t index);
         
         inline void framebufferSizeCallback(int width, int height);
         inline void mouseCallback(double xPos, double yPos);
@@ -45,20 +160,27 @@ class Application
 
     private:
         GLFWwindow* glfwSetup();
-        void processInput(GLFWwindow* window);
-        void renderScene(const Camera* cam);
-        void renderReflection();
+        void processInput(unsigned long frame);
+        void streamScene();
+        glm::mat4 projectionMatrix(const Camera* cam) const;
+        void updateCameraBlocks();
+        void updateWaterResolution();
+        void renderScene(size_t cameraSlot, RenderPass pass, int targetHeight, int clipPlane = RenderList::NoClipPlane);
+        void setClippingPlane(const glm::vec4& plane);
+        void renderReflection(unsigned long frame);
 
     private:
 
         unsigned int _viewportWidth;
         unsigned int _viewportHeight;
-        GLFWwindow* _window;
+        Surface* _surface;
+        GLFWwindow* _window;    // nullptr or hidden when headless
         Scene* _scene;
         Camera* _camera;
 
         float _deltaTime;   // time since previous frame
         float _prevFrame;   // time of previous frame
+        double _time = 0.0; // seconds since start, simulated when replaying a camera path
         float _prevMouseX, _prevMouseY; // position of mouse at previous frame
         bool _firstMouse;   // is first time we are reading mouse position
 
@@ -66,12 +188,50 @@ class Application
         Shader* _lightSourceShader;
         Shader* _skyBoxShader;
         Shader* _waterShader;
+        DeferredRenderer* _deferredRenderer = nullptr;
+
+        // camera slot 0 is the main camera (also used by refraction passes),
+        // slot 1 + i is the reflected camera of water group i
+        CameraUniformBuffer* _cameraBuffer;
+        LightUniformBuffer* _lightBuffer;
+        std::vector<Frustum> _cameraFrustums;     // one per camera slot
+        std::vector<glm::vec3> _cameraEyes;
+        std::vector<glm::mat4> _cameraViewProjections;
+        std::vector<glm::vec4> _clipPlanes;       // 2 * i: reflection, 2 * i + 1: refraction plane of water group i
+        RenderList _renderList;
+
+        std::vector<WaterGroup> _waterGroups;
+        DynamicResolution _waterResolution;
+        WaterUpdatePolicy _waterPolicy;
+        unsigned long _waterPassesRendered[2] = {};  // reflection, refraction
+        double _waterPixelFraction = 0.0;            // summed scissored fraction of the targets per pass
+
+        CullStats _cullStats[NumRenderPasses];
+
+        RenderQueue _renderQueue;
+        GpuTimer _gpuTimer;
+        unsigned long _frameLimit = 0;
+        float _profileReportInterval = 0.0f;
+
+        float _lodBias[NumRenderPasses] = { 1.0f, 2.0f, 2.0f };
+        bool _lodEnabled = true;
+
+        SceneStreamer* _streamer = nullptr;
+        float _uploadBudget = 4.0f;
+        CameraPath* _recordPath = nullptr;
+        const CameraPath* _replayPath = nullptr;
 };
 
-Application::Application(unsigned int viewportWidth, unsigned int viewportHeight)
+Application::Application(unsigned int viewportWidth, unsigned int viewportHeight, bool headless)
     : _viewportWidth(viewportWidth), _viewportHeight(viewportHeight)
 {
-    _window = glfwSetup();
+    if (headless) {
+        _surface = Surface::createHeadless(viewportWidth, viewportHeight);
+    } else {
+        GLFWwindow* window = glfwSetup();
+        _surface = window ? new Surface(window) : nullptr;
+    }
+    _window = _surface ? _surface->window() : nullptr;
     _scene = nullptr;
     _camera = nullptr;
 
@@ -79,10 +239,28 @@ Application::Application(unsigned int viewportWidth, unsigned int viewportHeight
     _prevFrame = 0.0f;
     _firstMouse = true;
 
+    _entityShader = _lightSourceShader = _skyBoxShader = _waterShader = nullptr;
+    _cameraBuffer = nullptr;
+    _lightBuffer = nullptr;
+    if (!_surface)
+        return;
+
     _entityShader      = new Shader("../include/Entity/shader.vert", "../include/Entity/shader.frag");
     _lightSourceShader = new Shader("../include/LightSource/shader.vert", "../include/LightSource/shader.frag");
     _skyBoxShader      = new Shader("../include/Skybox/shader.vert", "../include/Skybox/shader.frag");
     _waterShader       = new Shader("../include/Water/shader.vert", "../include/Water/shader.frag");
+
+    for (Shader* shader : { _entityShader, _lightSourceShader, _skyBoxShader, _waterShader }) {
+        shader->bindUniformBlock(ubo::CameraBlockName, ubo::CameraBinding);
+        shader->bindUniformBlock(ubo::LightsBlockName, ubo::LightsBinding);
+    }
+
+    Material::bindSamplers(*_entityShader);
+
+    _cameraBuffer = new CameraUniformBuffer();
+    _lightBuffer = new LightUniformBuffer();
+
+    _gpuTimer.init();
 }
 
 Application::~Application()
@@ -91,11 +269,21 @@ Application::~Application()
     delete _lightSourceShader;
     delete _skyBoxShader;
     delete _waterShader;
+    delete _deferredRenderer;
+    delete _cameraBuffer;
+    delete _lightBuffer;
+    _gpuTimer.release();
+    delete _surface;
     glfwTerminate();
 }
 
 bool Application::ready() const 
 {
+    if (!_surface) {
+        std::cout << "APPLICATION::ERROR: Could not create a window or offscreen context" << std::endl;
+        return false;
+    }
+
     if (!_scene || !_camera) {
         std::cout << "APPLICATION::ERROR: Could not find attached scene or camera" << std::endl;
         return false;
@@ -114,20 +302,155 @@ void Application::run()
     if (!ready())
         return;
 
-    while(!glfwWindowShouldClose(_window)) {
-        processInput(_window);
+    unsigned long frames = 0, lookupsAvoided = 0;
+    CullStats cullTotals[NumRenderPasses];
+    double cpuFrameSeconds = 0.0, transformSeconds = 0.0, waterScaleTotal = 0.0;
+    _waterPassesRendered[0] = _waterPassesRendered[1] = 0;
+    _waterPixelFraction = 0.0;
+    unsigned long transformsUpdated = 0;
+    std::vector<float> frameMs;
+    Shader::resetLookupsAvoided();
+
+    unsigned long frameLimit = _frameLimit;
+    if (_replayPath && (frameLimit == 0 || frameLimit > _replayPath->size()))
+        frameLimit = _replayPath->size();
+
+    double lastProfileReport = _surface->time();
+
+    while(!_surface->shouldClose() && (frameLimit == 0 || frames < frameLimit)) {
+        Profiler::instance().endFrame();
+        _gpuTimer.beginFrame();
+        if (_profileReportInterval > 0.0f && _surface->time() - lastProfileReport >= _profileReportInterval) {
+            Profiler::instance().printAverages();
+            lastProfileReport = _surface->time();
+        }
+
+        PROFILE_ZONE("frame");
+        double frameStart = _surface->time();
+        {
+            PROFILE_ZONE("input");
+            processInput(frames);
+        }
+
+        for (auto& stats : _cullStats)
+            stats = CullStats();
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        renderScene(_camera);
+        if (_streamer && !_streamer->done()) {
+            PROFILE_ZONE("streaming");
+            streamScene();
+        }
+
+        // recompute the transforms of everything that moved since the last frame
+        {
+            PROFILE_ZONE("transforms");
+            double transformStart = _surface->time();
+            transformsUpdated += TransformStore::instance().update();
+            transformSeconds += _surface->time() - transformStart;
+        }
+        {
+            PROFILE_ZONE("visibility");
+            updateCameraBlocks();
+            _renderList.build(*_scene, _cameraFrustums, _clipPlanes);
+            updateWaterResolution();
+        }
+        for (const auto& group : _waterGroups)
+            waterScaleTotal += group.scale;
+        {
+            PROFILE_ZONE("main pass");
+            int fWidth, fHeight;
+            _surface->framebufferSize(fWidth, fHeight);
+            renderScene(0, MainPass, fHeight);
+        }
 
         if (!_scene->waters.empty()) {
-            renderReflection();
+            renderReflection(frames);
+        }
+
+        // CPU time spent submitting the frame, excluding the wait in swap
+        double cpuSeconds = _surface->time() - frameStart;
+        cpuFrameSeconds += cpuSeconds;
+        frameMs.push_back(float(1000.0 * cpuSeconds));
+
+        {
+            PROFILE_ZONE("swap");
+            _surface->present();
         }
+        {
+            PROFILE_ZONE("poll events");
+            _surface->pollEvents();
+        }
+
+        lookupsAvoided += Shader::resetLookupsAvoided();
+        for (int pass = 0; pass < NumRenderPasses; pass++) {
+            cullTotals[pass].visible += _cullStats[pass].visible;
+            cullTotals[pass].culled += _cullStats[pass].culled;
+            cullTotals[pass].clipped += _cullStats[pass].clipped;
+            cullTotals[pass].straddling += _cullStats[pass].straddling;
+            cullTotals[pass].triangles += _cullStats[pass].triangles;
+            cullTotals[pass].lights += _cullStats[pass].lights;
+        }
+        frames++;
+    }
 
-        glfwSwapBuffers(_window);
-        glfwPollEvents();
+    if (Profiler::enabled()) {
+        Profiler::instance().endFrame();
+        Profiler::instance().printAverages();
+        if (_gpuTimer.droppedFrames() > 0) {
+            std::cout << "GPUTIMER::STATS: GPU times of " << _gpuTimer.droppedFrames()
+                      << " frames dropped, the GPU was more than a frame behind" << std::endl;
+        }
+    }
+
+    if (frames > 0) {
+        std::cout << "FRAME::STATS: " << 1000.0 * cpuFrameSeconds / frames
+                  << " ms average CPU frame time over " << frames << " frames" << std::endl;
+        auto percentile = [&frameMs](double p) {
+            auto nth = frameMs.begin() + size_t(p * (frameMs.size() - 1));
+            std::nth_element(frameMs.begin(), nth, frameMs.end());
+            return *nth;
+        };
+        std::cout << "FRAME::STATS: " << percentile(0.5) << " / " << percentile(0.95) << " / "
+                  << percentile(0.99) << " ms median / 95th / 99th percentile CPU frame time" << std::endl;
+        std::cout << "TRANSFORM::STATS: " << 1000.0 * transformSeconds / frames << " ms, "
+                  << transformsUpdated / frames << " of " << TransformStore::instance().size()
+                  << " transforms updated per frame" << std::endl;
+        if (!_waterGroups.empty()) {
+            double waterFrames = double(frames * _waterGroups.size());
+            std::cout << "WATER::STATS: " << _scene->waters.size() << " waters on "
+                      << _waterGroups.size() << " planes" << std::endl;
+            std::cout << "WATER::STATS: " << waterScaleTotal / waterFrames
+                      << " average reflection/refraction resolution scale ("
+                      << _waterResolution.frameBudget() << " ms frame budget)" << std::endl;
+            std::cout << "WATER::STATS: reflection re-rendered on " << 100.0 * _waterPassesRendered[0] / waterFrames
+                      << "%, refraction on " << 100.0 * _waterPassesRendered[1] / waterFrames
+                      << "% of frames" << std::endl;
+            unsigned long passes = _waterPassesRendered[0] + _waterPassesRendered[1];
+            if (passes > 0) {
+                std::cout << "WATER::STATS: " << 100.0 * _waterPixelFraction / passes
+                          << "% of each target shaded on average (scissored to the water)" << std::endl;
+            }
+        }
+        std::cout << "SHADER::STATS: " << lookupsAvoided / frames
+                  << " glGetUniformLocation calls avoided per frame" << std::endl;
+
+        const char* passNames[NumRenderPasses] = { "main", "reflection", "refraction" };
+        for (int pass = 0; pass < NumRenderPasses; pass++) {
+            const CullStats& total = cullTotals[pass];
+            std::cout << "CULLING::STATS: " << passNames[pass] << " pass: "
+                      << total.visible / frames << " visible ("
+                      << total.straddling / frames << " clipped by the water plane), "
+                      << total.culled / frames << " outside the frustum, "
+                      << total.clipped / frames << " below/above the water plane per frame" << std::endl;
+            std::cout << "LOD::STATS: " << passNames[pass] << " pass: " << total.triangles / frames
+                      << " triangles per frame" << (_lodEnabled ? "" : " (levels of detail disabled)") << std::endl;
+            if (_deferredRenderer) {
+                std::cout << "LIGHTING::STATS: " << passNames[pass] << " pass: " << total.lights / frames
+                          << " of " << _scene->pointLights.size() << " point lights shaded per frame" << std::endl;
+            }
+        }
     }
 }
 
@@ -177,32 +500,42 @@ void Application::attachScene(Scene& scene)
 
     glUniform1f(glGetUniformLocation(_entityShader->ID, "material.shininess"), 32.0f);
     
-    /** Set uniforms that do not change throughout the scene **/
-    _entityShader->use();
-
-    for (int i = 0; i < _scene->dirLights.size(); i++) {
-        std::string name = std::string("dirLights[") + std::to_string(i) + std::string("]");
-        DirLight dirLight = _scene->dirLights[i];
-        _entityShader->setVec3(name + std::string(".direction"), dirLight._direction);
-        _entityShader->setVec3(name + std::string(".ambient"), dirLight._ambient);
-        _entityShader->setVec3(name + std::string(".diffuse"), dirLight._diffuse);
-        _entityShader->setVec3(name + std::string(".specular"), dirLight._specular);
-    }
+    /** Upload light arrays once; use updatePointLight() when a light changes **/
+    _lightBuffer->set(_scene->pointLights, _scene->dirLights);
 
-    for (int i = 0; i < _scene->pointLights.size(); i++) {
-        
-        std::string name = std::string("pointLights[") + std::to_string(i) + std::string("]");       
-        PointLight& pl = _scene->pointLights[i];
-        _entityShader->setVec3(name + ".ambient", pl.ambient());
-        _entityShader->setVec3(name + ".diffuse", pl.diffuse());
-        _entityShader->setVec3(name + ".specular", pl.specular());
-        _entityShader->setVec3(name + ".position", pl.position());
-        _entityShader->setFloat(name + ".kConstant", pl.kConstant()); 
-        _entityShader->setFloat(name + ".kLinear", pl.kLinear());
-        _entityShader->setFloat(name + ".kQuadratic", pl.kQuadratic());
+    /** Coplanar waters share one framebuffer and one reflection/refraction pass pair **/
+    _waterGroups = WaterGroup::build(_scene->waters);
+}
+
+void Application::setDeferred(bool enabled)
+{
+    if (!enabled) {
+        delete _deferredRenderer;
+        _deferredRenderer = nullptr;
+    } else if (!_deferredRenderer && _surface) {
+        _deferredRenderer = new DeferredRenderer();
     }
 }
 
+void Application::updatePointLight(size_t index)
+{
+    if (_scene && index < _scene->pointLights.size())
+        _lightBuffer->updatePointLight(index, _scene->pointLights[index]);
+}
+
+void Application::streamScene()
+{
+    // prioritise what the camera saw last frame
+    const Frustum* view = _cameraFrustums.empty() ? nullptr : &_cameraFrustums[0];
+    size_t numPointLights = _scene->pointLights.size();
+
+    if (_streamer->update(_uploadBudget, view, _camera->getPosition()) == 0)
+        return;
+
+    if (_scene->pointLights.size() != numPointLights)
+        _lightBuffer->set(_scene->pointLights, _scene->dirLights);
+}
+
 void Application::attachCamera(Camera& camera)
 {
     _camera = &camera;
@@ -236,103 +569,245 @@ inline void Application::scrollCallback(double xoffset, double yoffset)
     _camera->scroll_callback(xoffset, yoffset);
 }
 
-void Application::processInput(GLFWwindow* window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-    
-    float currentFrame = glfwGetTime();
+void Application::processInput(unsigned long frame) {
+    // nobody is at the keyboard of a headless run
+    bool live = !_surface->headless();
+    if (live && glfwGetKey(_window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+        glfwSetWindowShouldClose(_window, true);
+
+    if (_replayPath) {
+        // the recorded frame time keeps the dynamic resolution choices of the recording
+        _deltaTime = _replayPath->key(frame).frameMs / 1000.0f;
+        _time = frame * double(_replayPath->timestep());
+        _replayPath->apply(frame, *_camera);
+        return;
+    }
+
+    float currentFrame = _surface->time();
     _deltaTime = currentFrame - _prevFrame;
     _prevFrame = currentFrame;
+    _time = currentFrame;
     _camera->scaleSpeed(_deltaTime * 60.0f);
-    _camera->process_input(window);
+
+    if (live)
+        _camera->process_input(_window);
+
+    if (_recordPath)
+        _recordPath->record(*_camera, 1000.0f * _deltaTime);
 }
 
-void Application::renderScene(const Camera* cam)
+glm::mat4 Application::projectionMatrix(const Camera* cam) const
 {
-    glEnable(GL_DEPTH_TEST);
+    return glm::perspective(glm::radians(cam->getFov()), (float)(_viewportWidth) / _viewportHeight, 0.1f, 100.0f);
+}
+
+/**
+ * @brief Fill one Camera block per render pass and upload them together, so each
+ * pass only has to bind its slot.
+ */
+void Application::updateCameraBlocks()
+{
+    glm::mat4 projection = projectionMatrix(_camera);
+    glm::mat4 view = _camera->lookAt();
+    _cameraBuffer->setSlot(0, view, projection, _camera->getPosition());
+
+    _cameraFrustums.resize(1 + _waterGroups.size());
+    _cameraEyes.resize(1 + _waterGroups.size());
+    _cameraEyes[0] = _camera->getPosition();
+    _cameraViewProjections.resize(1 + _waterGroups.size());
+    _cameraViewProjections[0] = projection * view;
+    _cameraFrustums[0] = Frustum::fromMatrix(_cameraViewProjections[0]);
+    _clipPlanes.resize(2 * _waterGroups.size());
+
+    for (size_t i = 0; i < _waterGroups.size(); i++) {
+        const glm::vec4& plane = _waterGroups[i].plane;
+        Camera camReflected = _camera->reflect(plane);
+        glm::mat4 reflectedView = camReflected.lookAt();
+        _cameraBuffer->setSlot(1 + i, reflectedView, projection, camReflected.getPosition());
+        _cameraEyes[1 + i] = camReflected.getPosition();
+        _cameraViewProjections[1 + i] = projection * reflectedView;
+        _cameraFrustums[1 + i] = Frustum::fromMatrix(_cameraViewProjections[1 + i]);
+
+        glm::vec4 planeFlipped = -plane;
+        planeFlipped.w = plane.w;
+        _clipPlanes[2 * i] = plane;
+        _clipPlanes[2 * i + 1] = planeFlipped;
+    }
 
-    glm::mat4 view = cam->lookAt(); 
-    glm::mat4 projection = glm::perspective(glm::radians(cam->getFov()), (float)(_viewportWidth) / _viewportHeight, 0.1f, 100.0f); 
+    _cameraBuffer->upload();
+}
 
-    // render light source
-    _lightSourceShader->use();
-    _lightSourceShader->setMat4("view", view);
-    _lightSourceShader->setMat4("projection", projection); 
+/**
+ * @brief Size each water group's reflection and refraction targets from the frame time
+ * and the group's coverage of the screen.
+ */
+void Application::updateWaterResolution()
+{
+    _waterResolution.update(1000.0f * _deltaTime);
 
-    for (auto& pls : _scene->pointLights) {
-        pls.draw(_lightSourceShader);
+    int fWidth, fHeight;
+    _surface->framebufferSize(fWidth, fHeight);
+    const glm::mat4& viewProjection = _cameraViewProjections[0];
+
+    for (auto& group : _waterGroups) {
+        group.updateScreenBounds(viewProjection);
+        group.scale = _waterResolution.scale(group.coverage);
+        if (group.frameBuffer()->resize((int)(group.scale * fWidth), (int)(group.scale * fHeight)))
+            group.refresh.valid = false;    // contents are gone, re-render both
     }
+}
 
-    // render entities
-    _entityShader->use();
-    _entityShader->setMat4("view", view);
-    _entityShader->setMat4("projection", projection);
-    _entityShader->setInt("numDirLights", _scene->dirLights.size());
-    _entityShader->setInt("numPointLights", _scene->pointLights.size());
-    
-    for (auto& entity : _scene->entities) {
-        entity.draw(_entityShader);
+static const char* gpuPassZones[NumRenderPasses] = { "gpu main scene", "gpu reflection", "gpu refraction" };
+
+void Application::renderScene(size_t cameraSlot, RenderPass pass, int targetHeight, int clipPlane)
+{
+    GpuZone gpuZone(_gpuTimer, gpuPassZones[pass]);
+    glEnable(GL_DEPTH_TEST);
+
+    _cameraBuffer->bind(cameraSlot);
+
+    // levels of detail are picked from the size objects have in this pass's target
+    LodView lod;
+    lod.eye = _cameraEyes[cameraSlot];
+    lod.pixelScale = 0.5f * targetHeight * projectionMatrix(_camera)[1][1];
+    lod.maxPixelError = _lodBias[pass];
+
+    const LodView* lodView = _lodEnabled ? &lod : nullptr;
+
+    // deferred: entities go to the G-buffer and are lit into the target, whose depth
+    // the light sources and skybox below then test against
+    Shader* entityShader = _entityShader;
+    if (_deferredRenderer) {
+        {
+            PROFILE_ZONE("geometry");
+            _deferredRenderer->beginGeometry();
+            _renderList.submit(_renderQueue, _deferredRenderer->geometryShader(), nullptr, cameraSlot, clipPlane,
+                               _cullStats[pass], lodView);
+            _renderQueue.flush();
+            _cullStats[pass].triangles += _renderQueue.stats().triangles;
+        }
+        {
+            PROFILE_ZONE("lighting");
+            GpuZone gpuLighting(_gpuTimer, "gpu lighting");
+            _cullStats[pass].lights += _deferredRenderer->light(_scene->pointLights, _cameraFrustums[cameraSlot],
+                                                                _cameraViewProjections[cameraSlot]);
+        }
+        entityShader = nullptr;
+    }
+
+    // queue the light sources and entities the render list found visible for this camera
+    // and clip plane; the queue sorts by clipping, shader, material and VAO
+    {
+        PROFILE_ZONE("submit");
+        _renderList.submit(_renderQueue, entityShader, _lightSourceShader, cameraSlot, clipPlane, _cullStats[pass], lodView);
+    }
+    {
+        PROFILE_ZONE("flush");
+        _renderQueue.flush();
+        _cullStats[pass].triangles += _renderQueue.stats().triangles;
     }
 
     // render skybox if it exists
     if (_scene->skyBox != nullptr) {
+        PROFILE_ZONE("skybox");
+        GpuZone gpuSkyBox(_gpuTimer, "gpu skybox");
         _skyBoxShader->use();
-        glm::mat4 viewWithoutTranslation = glm::mat4(glm::mat3(view));
-        _skyBoxShader->setMat4("view", viewWithoutTranslation);
-        _skyBoxShader->setMat4("projection", projection);
         _scene->skyBox->draw(_skyBoxShader); 
     }
 }
 
-void Application::renderReflection()
+/**
+ * @brief Re-render the reflection and refraction textures the update policy asks for
+ * and draw every water. Skipped textures keep their contents and are reprojected by
+ * the water shader.
+ */
+void Application::renderReflection(unsigned long frame)
 {
+    float sceneMotion = TransformStore::instance().lastMotion();
+
+    for (size_t i = 0; i < _waterGroups.size(); i++) {
+        WaterGroup& group = _waterGroups[i];
+        if (!group.onScreen())
+            continue;
+
+        auto waterFBO = group.frameBuffer();
+        const glm::vec4& plane = _clipPlanes[2 * i];
+        const glm::vec4& planeFlipped = _clipPlanes[2 * i + 1];
+
+        bool reflection, refraction;
+        _waterPolicy.decide(group.refresh, frame, *_camera, sceneMotion, reflection, refraction);
+
+        // only the part of each target the water covers (plus the distortion margin) is
+        // ever sampled, so clear and shade just that rectangle
+        const float distortionPadding = 0.04f;      // 2 * distortionStrength in Water/shader.frag, in NDC
+        glm::ivec4 reflectionRect, refractionRect;
+        reflection = reflection && group.scissorRect(_cameraViewProjections[1 + i], distortionPadding, reflectionRect);
+        refraction = refraction && group.scissorRect(_cameraViewProjections[0], distortionPadding, refractionRect);
+        float targetPixels = float(waterFBO->width()) * waterFBO->height();
+
+        if (reflection) {
+            PROFILE_ZONE("reflection pass");
+            GpuZone gpuZone(_gpuTimer, "gpu water pass setup");    // the pass itself is timed in renderScene
+            setClippingPlane(plane);
+
+            waterFBO->bindReflectionFrameBuffer();
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(reflectionRect.x, reflectionRect.y, reflectionRect.z, reflectionRect.w);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glEnable(GL_DEPTH_TEST);
+
+            // GL_CLIP_DISTANCE0 is enabled by the queue for objects crossing the plane only
+            renderScene(1 + i, ReflectionPass, waterFBO->height(), 2 * i);
+            glDisable(GL_SCISSOR_TEST);
+            waterFBO->unbindReflectionFrameBuffer(_surface);
+            waterFBO->setReflectionViewProjection(_cameraViewProjections[1 + i]);
+            _waterPassesRendered[0]++;
+            _waterPixelFraction += reflectionRect.z * reflectionRect.w / targetPixels;
+        }
 
-    for (auto& water : _scene->waters) {
-        
-        glm::vec4 plane = water.getPlaneEquation();
-        glm::vec4 planeFlipped = -plane;
-        planeFlipped.w = plane.w;
-
-        _lightSourceShader->use();
-        _lightSourceShader->setVec4("reflectionClippingPlane", plane); 
-        _entityShader->use();
-        _entityShader->setVec4("reflectionClippingPlane", plane); 
-
-        // render reflection
-        auto waterFBO = water.getWaterFrameBuffer();
-        waterFBO->bindReflectionFrameBuffer();
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
-
-        Camera camReflected = _camera->reflect(plane);
-
-        glEnable(GL_CLIP_DISTANCE0);
-        renderScene(&camReflected);
-        waterFBO->unbindReflectionFrameBuffer(_window);
-        glDisable(GL_CLIP_DISTANCE0);
-        
-        // render refraction
-        _lightSourceShader->use();
-        _lightSourceShader->setVec4("reflectionClippingPlane", planeFlipped); 
-
-        _entityShader->use();
-        _entityShader->setVec4("reflectionClippingPlane", planeFlipped); 
-        waterFBO->bindRefractionFrameBuffer();
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glEnable(GL_DEPTH_TEST);
-
-        glEnable(GL_CLIP_DISTANCE0);
-        renderScene(_camera);
-        waterFBO->unbindRefractionFrameBuffer(_window);
-        glDisable(GL_CLIP_DISTANCE0);
-        
-        // draw water
-        water.draw(_waterShader, _camera, _viewportWidth, _viewportHeight); 
+        if (refraction) {
+            PROFILE_ZONE("refraction pass");
+            GpuZone gpuZone(_gpuTimer, "gpu water pass setup");    // the pass itself is timed in renderScene
+            setClippingPlane(planeFlipped);
+
+            waterFBO->bindRefractionFrameBuffer();
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(refractionRect.x, refractionRect.y, refractionRect.z, refractionRect.w);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glEnable(GL_DEPTH_TEST);
+
+            renderScene(0, RefractionPass, waterFBO->height(), 2 * i + 1);
+            glDisable(GL_SCISSOR_TEST);
+            waterFBO->unbindRefractionFrameBuffer(_surface);
+            waterFBO->setRefractionViewProjection(_cameraViewProjections[0]);
+            _waterPassesRendered[1]++;
+            _waterPixelFraction += refractionRect.z * refractionRect.w / targetPixels;
+        }
+        _waterPolicy.rendered(group.refresh, *_camera, reflection, refraction);
+
+        // draw every water of the plane with the shared textures
+        PROFILE_ZONE("water draw");
+        GpuZone gpuZone(_gpuTimer, "gpu water composite");
+        _cameraBuffer->bind(0);
+        for (Water* water : group.members)
+            water->draw(_waterShader, _camera, float(_time));
     }
 }
 
+/* Clip plane of the reflection or refraction pass, for every program drawing the scene */
+void Application::setClippingPlane(const glm::vec4& plane)
+{
+    Shader* shaders[] = { _lightSourceShader, _entityShader,
+                          _deferredRenderer ? _deferredRenderer->geometryShader() : nullptr };
+    for (Shader* shader : shaders) {
+        if (!shader)
+            continue;
+        shader->use();
+        shader->setVec4("reflectionClippingPlane"_u, plane);
+    }
+}
 
 /** GLFW Callback definitions **/
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
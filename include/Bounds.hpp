@@ -0,0 +1,153 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cfloat>
+#include <cstdint>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+/* Axis-aligned bounding box. Default constructed boxes are empty. */
+struct AABB {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool empty() const {
+        return min.x > max.x;
+    }
+
+    glm::vec3 center() const {
+        return 0.5f * (min + max);
+    }
+
+    glm::vec3 extents() const {
+        return 0.5f * (max - min);
+    }
+
+    void expand(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void expand(const AABB& b) {
+        if (b.empty())
+            return;
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    /* Tight box around this box after an affine transform (Arvo's method) */
+    AABB transformed(const glm::mat4& m) const {
+        if (empty())
+            return *this;
+
+        glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+        glm::vec3 e = extents();
+        glm::vec3 r;
+        for (int i = 0; i < 3; i++) {
+            r[i] = std::abs(m[0][i]) * e.x + std::abs(m[1][i]) * e.y + std::abs(m[2][i]) * e.z;
+        }
+
+        AABB out;
+        out.min = c - r;
+        out.max = c + r;
+        return out;
+    }
+};
+
+/* Largest factor an affine transform scales lengths by */
+inline float maxScale(const glm::mat4& m) {
+    float sx = glm::length(glm::vec3(m[0]));
+    float sy = glm::length(glm::vec3(m[1]));
+    float sz = glm::length(glm::vec3(m[2]));
+    return std::max(sx, std::max(sy, sz));
+}
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = -1.0f;           // negative radius means empty
+
+    bool empty() const {
+        return radius < 0.0f;
+    }
+
+    BoundingSphere transformed(const glm::mat4& m) const {
+        if (empty())
+            return *this;
+
+        BoundingSphere out;
+        out.center = glm::vec3(m * glm::vec4(center, 1.0f));
+        out.radius = radius * maxScale(m);
+        return out;
+    }
+};
+
+/* Side of a plane (ax + by + cz + d >= 0 is kept, as with gl_ClipDistance) a box lies on */
+enum class PlaneSide : uint8_t {
+    Inside,
+    Outside,
+    Straddling
+};
+
+inline PlaneSide classify(const AABB& b, const glm::vec4& plane) {
+    if (b.empty())
+        return PlaneSide::Outside;
+
+    float d = glm::dot(glm::vec3(plane), b.center()) + plane.w;
+    float r = glm::dot(b.extents(), glm::abs(glm::vec3(plane)));
+    if (d - r >= 0.0f)
+        return PlaneSide::Inside;
+    if (d + r < 0.0f)
+        return PlaneSide::Outside;
+    return PlaneSide::Straddling;
+}
+
+/**
+ * View frustum as six inward-facing planes (ax + by + cz + d >= 0 inside),
+ * extracted from a view-projection matrix (Gribb & Hartmann).
+ */
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& viewProjection) {
+        Frustum f;
+        glm::mat4 m = glm::transpose(viewProjection);   // rows of the matrix
+        f.planes[0] = m[3] + m[0];      // left
+        f.planes[1] = m[3] - m[0];      // right
+        f.planes[2] = m[3] + m[1];      // bottom
+        f.planes[3] = m[3] - m[1];      // top
+        f.planes[4] = m[3] + m[2];      // near
+        f.planes[5] = m[3] - m[2];      // far
+
+        for (auto& p : f.planes) {
+            p /= glm::length(glm::vec3(p));
+        }
+        return f;
+    }
+
+    bool intersects(const BoundingSphere& s) const {
+        if (s.empty())
+            return false;
+
+        for (const auto& p : planes) {
+            if (glm::dot(glm::vec3(p), s.center) + p.w < -s.radius)
+                return false;
+        }
+        return true;
+    }
+
+    bool intersects(const AABB& b) const {
+        if (b.empty())
+            return false;
+
+        glm::vec3 c = b.center(), e = b.extents();
+        for (const auto& p : planes) {
+            float r = glm::dot(e, glm::abs(glm::vec3(p)));
+            if (glm::dot(glm::vec3(p), c) + p.w < -r)
+                return false;
+        }
+        return true;
+    }
+};
+
+#endif // BOUNDS_H
@@ -0,0 +1,116 @@
+#include "CameraPath.hpp"
+
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+/**
+ * File layout (native endianness):
+ *      FileHeader
+ *      Key[numKeys]
+ */
+namespace {
+
+    const char kMagic[4] = { 'G', 'L', 'W', 'P' };
+    const uint32_t kVersion = 1;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t keySize;
+        uint32_t numKeys;
+        float timestep;
+    };
+
+    struct Key {
+        float position[3];
+        float front[3];
+        float yaw, pitch, fov;
+        float frameMs;
+    };
+}
+
+void CameraPath::record(const Camera& camera, float frameMs)
+{
+    _keys.push_back({ camera.getPosition(), camera.getFront(),
+                      camera.getYaw(), camera.getPitch(), camera.getFov(), frameMs });
+}
+
+bool CameraPath::apply(size_t frame, Camera& camera) const
+{
+    if (frame >= _keys.size())
+        return false;
+
+    const CameraKey& key = _keys[frame];
+    camera.setPosition(key.position);
+    camera.setFront(key.front);
+    camera.setYaw(key.yaw);
+    camera.setPitch(key.pitch);
+    camera.setFov(key.fov);
+    return true;
+}
+
+bool CameraPath::save(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "CAMERAPATH::ERROR: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.keySize = sizeof(Key);
+    header.numKeys = static_cast<uint32_t>(_keys.size());
+    header.timestep = _timestep;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (const CameraKey& k : _keys) {
+        Key key = { { k.position.x, k.position.y, k.position.z }, { k.front.x, k.front.y, k.front.z },
+                    k.yaw, k.pitch, k.fov, k.frameMs };
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    }
+
+    if (!out) {
+        std::cout << "CAMERAPATH::ERROR: Failed to write " << path << std::endl;
+        return false;
+    }
+    std::cout << "CAMERAPATH::INFO: Recorded " << _keys.size() << " frames to " << path << std::endl;
+    return true;
+}
+
+bool CameraPath::load(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cout << "CAMERAPATH::ERROR: Could not open " << path << std::endl;
+        return false;
+    }
+
+    FileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+        || header.version != kVersion || header.keySize != sizeof(Key) || !(header.timestep > 0.0f)) {
+        std::cout << "CAMERAPATH::ERROR: " << path << " is not a camera path" << std::endl;
+        return false;
+    }
+
+    std::vector<Key> keys(header.numKeys);
+    in.read(reinterpret_cast<char*>(keys.data()), keys.size() * sizeof(Key));
+    if (!in) {
+        std::cout << "CAMERAPATH::ERROR: " << path << " is truncated" << std::endl;
+        return false;
+    }
+
+    _timestep = header.timestep;
+    _keys.clear();
+    _keys.reserve(keys.size());
+    for (const Key& key : keys) {
+        _keys.push_back({ glm::vec3(key.position[0], key.position[1], key.position[2]),
+                          glm::vec3(key.front[0], key.front[1], key.front[2]),
+                          key.yaw, key.pitch, key.fov, key.frameMs });
+    }
+    return true;
+}
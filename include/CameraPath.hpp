@@ -0,0 +1,58 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "Camera.hpp"
+
+/* Camera state and frame time of one recorded frame */
+struct CameraKey {
+    glm::vec3 position;
+    glm::vec3 front;
+    float yaw, pitch, fov;
+    float frameMs;
+};
+
+/**
+ * Recorded camera flight for reproducible benchmarks. Recording logs the camera and
+ * the frame time once per frame; replay restores them frame by frame while the
+ * application advances its clock by a fixed timestep, so every replay renders exactly
+ * the same frames regardless of how fast they are rendered.
+ *
+ * Stored as a small binary file: a header followed by the raw keys.
+ */
+class CameraPath
+{
+    public:
+        explicit CameraPath(float timestep = 1.0f / 60.0f) : _timestep(timestep) {}
+
+        void record(const Camera& camera, float frameMs);
+
+        /* Set the camera to the state recorded for a frame; false past the end */
+        bool apply(size_t frame, Camera& camera) const;
+
+        size_t size() const {
+            return _keys.size();
+        }
+
+        const CameraKey& key(size_t frame) const {
+            return _keys[frame];
+        }
+
+        /* Simulated seconds per replayed frame */
+        float timestep() const {
+            return _timestep;
+        }
+
+        bool save(const std::string& path) const;
+        bool load(const std::string& path);
+
+    private:
+        float _timestep;
+        std::vector<CameraKey> _keys;
+};
+
+#endif // CAMERA_PATH_H
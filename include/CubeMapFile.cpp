@@ -0,0 +1,277 @@
+#include "CubeMapFile.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <filesystem>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "stb/stb_image.h"
+
+#include "TextureCompressor.hpp"
+
+/**
+ * File layout (native endianness):
+ *
+ *  FileHeader
+ *  for each level, largest first:
+ *      for each face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X... order:
+ *          texels (RGBA8) or 4x4 blocks (BC1)
+ */
+namespace {
+
+    const char kMagic[4] = { 'G', 'L', 'W', 'C' };
+    const uint32_t kVersion = 1;
+    const int kNumFaces = 6;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t format;
+        uint32_t faceSize;
+        uint32_t numLevels;
+        uint32_t reserved;
+    };
+
+    uint32_t mipLevels(uint32_t size) {
+        uint32_t levels = 1;
+        while (size > 1) {
+            size /= 2;
+            levels++;
+        }
+        return levels;
+    }
+}
+
+CubeMapFile::CubeMapFile(const std::string& path)
+    : _path(path)
+{
+}
+
+CubeMapFile::~CubeMapFile()
+{
+    unmap();
+}
+
+size_t CubeMapFile::levelBytes(Format format, uint32_t size)
+{
+    if (format == BC1)
+        return size_t((size + 3) / 4) * ((size + 3) / 4) * texcomp::blockBytes(texcomp::BlockFormat::BC1);
+    return size_t(size) * size * 4;
+}
+
+std::vector<std::string> CubeMapFile::facePaths(const std::string& directory)
+{
+    std::vector<std::string> faces;
+    for (const char* name : { "px.png", "nx.png", "py.png", "ny.png", "pz.png", "nz.png" })
+        faces.push_back((std::filesystem::path(directory) / name).string());
+    return faces;
+}
+
+void CubeMapFile::unmap()
+{
+    if (_mapped) {
+        munmap(_mapped, _mappedSize);
+        _mapped = nullptr;
+        _mappedSize = 0;
+    }
+    _payload = nullptr;
+    _payloadSize = 0;
+}
+
+bool CubeMapFile::load()
+{
+    unmap();
+
+    int fd = open(_path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        close(fd);
+        return false;
+    }
+
+    _mappedSize = static_cast<size_t>(st.st_size);
+    _mapped = mmap(nullptr, _mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (_mapped == MAP_FAILED) {
+        _mapped = nullptr;
+        _mappedSize = 0;
+        return false;
+    }
+
+    const FileHeader* header = static_cast<const FileHeader*>(_mapped);
+    bool valid = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0
+        && header->version == kVersion
+        && (header->format == RGBA8 || header->format == BC1)
+        && header->faceSize > 0
+        && header->numLevels == mipLevels(header->faceSize);
+    if (!valid) {
+        std::cout << "CUBEMAPFILE::ERROR: " << _path << " is not a cubemap of a supported version" << std::endl;
+        unmap();
+        return false;
+    }
+
+    _format = static_cast<Format>(header->format);
+    _faceSize = header->faceSize;
+    _numLevels = header->numLevels;
+
+    size_t payloadSize = 0;
+    for (uint32_t level = 0; level < _numLevels; level++)
+        payloadSize += kNumFaces * levelBytes(_format, std::max(1u, _faceSize >> level));
+
+    if (sizeof(FileHeader) + payloadSize != _mappedSize) {
+        std::cout << "CUBEMAPFILE::ERROR: " << _path << " is truncated" << std::endl;
+        unmap();
+        return false;
+    }
+
+    _payload = static_cast<const unsigned char*>(_mapped) + sizeof(FileHeader);
+    _payloadSize = payloadSize;
+    return true;
+}
+
+bool CubeMapFile::upload(GLuint texture) const
+{
+    if (!_payload)
+        return false;
+
+    if (_format == BC1 && !texcomp::s3tcSupported()) {
+        std::cout << "CUBEMAPFILE::ERROR: " << _path << " is BC1 compressed, which the driver does not support" << std::endl;
+        return false;
+    }
+
+    // a single copy out of the page cache; the faces are then sourced from buffer offsets
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, _payloadSize, _payload, GL_STREAM_DRAW);
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    size_t offset = 0;
+    for (uint32_t level = 0; level < _numLevels; level++) {
+        GLsizei size = GLsizei(std::max(1u, _faceSize >> level));
+        size_t bytes = levelBytes(_format, size);
+
+        for (int face = 0; face < kNumFaces; face++) {
+            if (_format == BC1) {
+                glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                       size, size, 0, GLsizei(bytes), (const void*)offset);
+            } else {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGBA8, size, size, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, (const void*)offset);
+            }
+            offset += bytes;
+        }
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, GLint(_numLevels - 1));
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(1, &buffer);
+    return true;
+}
+
+bool CubeMapFile::pack(const std::vector<std::string>& faces, const std::string& path, bool compress)
+{
+    if (faces.size() != kNumFaces) {
+        std::cout << "CUBEMAPFILE::ERROR: A cubemap needs 6 faces, got " << faces.size() << std::endl;
+        return false;
+    }
+
+    // levels[face][level], each face decoded and encoded on its own thread
+    std::vector<std::vector<std::vector<uint8_t>>> levels(kNumFaces);
+    uint32_t sizes[kNumFaces] = {};
+    std::vector<std::thread> workers;
+    for (int face = 0; face < kNumFaces; face++) {
+        workers.emplace_back([&, face] {
+            int width, height, channels;
+            unsigned char* pixels = stbi_load(faces[face].c_str(), &width, &height, &channels, 4);
+            if (!pixels || width != height) {
+                stbi_image_free(pixels);
+                return;
+            }
+            sizes[face] = uint32_t(width);
+
+            std::vector<uint8_t> level(pixels, pixels + size_t(width) * height * 4);
+            stbi_image_free(pixels);
+
+            // only the current level is kept uncompressed
+            for (uint32_t size = sizes[face]; ; size /= 2) {
+                std::vector<uint8_t> next;
+                if (size > 1)
+                    next = texcomp::downsample(level.data(), size, size, false);
+
+                if (compress)
+                    levels[face].push_back(texcomp::compressLevel(level.data(), size, size, texcomp::BlockFormat::BC1));
+                else
+                    levels[face].push_back(std::move(level));
+
+                if (size == 1)
+                    break;
+                level = std::move(next);
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    for (int face = 0; face < kNumFaces; face++) {
+        if (sizes[face] == 0) {
+            std::cout << "CUBEMAPFILE::ERROR: Could not load square face " << faces[face] << std::endl;
+            return false;
+        }
+        if (sizes[face] != sizes[0]) {
+            std::cout << "CUBEMAPFILE::ERROR: Face " << faces[face] << " is " << sizes[face] << " texels wide, "
+                      << faces[0] << " is " << sizes[0] << std::endl;
+            return false;
+        }
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.format = compress ? BC1 : RGBA8;
+    header.faceSize = sizes[0];
+    header.numLevels = mipLevels(sizes[0]);
+    header.reserved = 0;
+
+    // write to a temporary file first so a crash never leaves a truncated cubemap behind
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "CUBEMAPFILE::ERROR: Could not open " << tmpPath << " for writing" << std::endl;
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (uint32_t level = 0; level < header.numLevels; level++) {
+        for (int face = 0; face < kNumFaces; face++)
+            out.write(reinterpret_cast<const char*>(levels[face][level].data()), levels[face][level].size());
+    }
+
+    out.close();
+    if (!out) {
+        std::cout << "CUBEMAPFILE::ERROR: Failed to write " << tmpPath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cout << "CUBEMAPFILE::ERROR: Could not replace " << path << ": " << ec.message() << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
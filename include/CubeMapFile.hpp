@@ -0,0 +1,90 @@
+#ifndef CUBE_MAP_FILE_H
+#define CUBE_MAP_FILE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "glad/glad.h"
+
+/**
+ * Single-file cubemap: the six faces of a skybox with their full mip chains, stored
+ * either as RGBA8 or BC1 blocks in exactly the layout GL consumes. The file is
+ * memory-mapped and streamed into a pixel unpack buffer in one copy, so loading costs
+ * no image decoding at all. Build one from a directory of px/nx/py/ny/pz/nz images
+ * with pack() (main --pack-skybox).
+ */
+class CubeMapFile
+{
+    public:
+        enum Format : uint32_t {
+            RGBA8 = 0,
+            BC1 = 1
+        };
+
+        explicit CubeMapFile(const std::string& path);
+        ~CubeMapFile();
+
+        CubeMapFile(const CubeMapFile&) = delete;
+        CubeMapFile& operator=(const CubeMapFile&) = delete;
+
+        /**
+         * @brief Memory-map and validate the file.
+         *
+         * @return true if it is a complete cubemap of a supported format.
+         */
+        bool load();
+
+        /**
+         * @brief Upload every face and level into texture, a GL_TEXTURE_CUBE_MAP.
+         * Must be called on the GL thread after load().
+         *
+         * @return false if the driver cannot sample the file's format.
+         */
+        bool upload(GLuint texture) const;
+
+        /**
+         * @brief Decode six face images (in GL_TEXTURE_CUBE_MAP_POSITIVE_X... order),
+         * build their mip chains and write them to path, BC1 compressed or as RGBA8.
+         * Faces must be square and of equal size. Needs no GL context.
+         */
+        static bool pack(const std::vector<std::string>& faces, const std::string& path, bool compress);
+
+        /* The six face images of a skybox directory: px, nx, py, ny, pz, nz .png */
+        static std::vector<std::string> facePaths(const std::string& directory);
+
+        uint32_t faceSize() const {
+            return _faceSize;
+        }
+
+        uint32_t levelCount() const {
+            return _numLevels;
+        }
+
+        Format format() const {
+            return _format;
+        }
+
+        /* Bytes of texel data, all faces and levels */
+        size_t bytes() const {
+            return _payloadSize;
+        }
+
+    private:
+        static size_t levelBytes(Format format, uint32_t size);
+        void unmap();
+
+    private:
+        std::string _path;
+
+        void* _mapped = nullptr;
+        size_t _mappedSize = 0;
+
+        const unsigned char* _payload = nullptr;
+        size_t _payloadSize = 0;
+        Format _format = RGBA8;
+        uint32_t _faceSize = 0;
+        uint32_t _numLevels = 0;
+};
+
+#endif // CUBE_MAP_FILE_H
@@ -0,0 +1,79 @@
+#version 330 core
+
+// std140: each vec3 shares a 16-byte slot with the float that follows it
+struct PointLight {
+   vec3 position;
+   float kConstant;
+   vec3 ambient;
+   float kLinear;
+   vec3 diffuse;
+   float kQuadratic;
+   vec3 specular;
+};
+
+struct DirectionalLight {
+   vec3 direction;         // defined in world space
+   vec3 ambient;
+   vec3 diffuse;
+   vec3 specular;
+};
+
+// must match ubo::MaxPointLights / ubo::MaxDirLights in UniformBlocks.hpp
+#define MAX_NUM_POINT_LIGHTS 4
+#define MAX_NUM_DIR_LIGHTS 1
+
+layout (std140) uniform Lights {
+   PointLight pointLights[MAX_NUM_POINT_LIGHTS];
+   DirectionalLight dirLights[MAX_NUM_DIR_LIGHTS];
+   int numPointLights;
+   int numDirLights;
+};
+
+layout (std140) uniform Camera {
+   mat4 view;
+   mat4 projection;
+   vec4 viewPos;           // defined in world space
+};
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 invViewProjection;
+uniform vec4 viewport;     // x, y, width, height
+
+out vec4 FragColor;
+
+void main()
+{
+   ivec2 texel = ivec2(gl_FragCoord.xy);
+   float depth = texelFetch(gDepth, texel, 0).r;
+   if (depth == 1.0f)
+      discard;             // no entity, keep the target's contents
+
+   vec2 ndc = (gl_FragCoord.xy - viewport.xy) / viewport.zw * 2.0f - 1.0f;
+   vec4 position = invViewProjection * vec4(ndc, depth * 2.0f - 1.0f, 1.0f);
+   vec3 fragPos = position.xyz / position.w;
+
+   vec3 diffuseColor = texelFetch(gAlbedo, texel, 0).rgb;
+   vec3 specularColor = texelFetch(gSpecular, texel, 0).rgb;
+   vec4 normalShininess = texelFetch(gNormal, texel, 0);
+   vec3 normal = normalShininess.xyz;
+   vec3 viewDir = normalize(viewPos.xyz - fragPos);
+
+   vec3 colorRGB = vec3(0.0f, 0.0f, 0.0f);
+   for (int i = 0; i < min(numDirLights, MAX_NUM_DIR_LIGHTS); i++) {
+      DirectionalLight light = dirLights[i];
+      vec3 lightDir = normalize(-light.direction);
+      vec3 reflectDir = reflect(-lightDir, normal);
+      float spec = pow(max(dot(viewDir, reflectDir), 0.0f), normalShininess.w);
+
+      colorRGB += diffuseColor * light.ambient
+                + max(dot(lightDir, normal), 0.0f) * diffuseColor * light.diffuse
+                + spec * specularColor * light.specular;
+   }
+
+   FragColor = vec4(colorRGB, 1.0f);
+   gl_FragDepth = depth;
+}
@@ -0,0 +1,43 @@
+#version 330 core
+
+// used with Entity/shader.vert; material uniforms as in Entity/shader.frag
+struct Material {
+   vec3 ambient;
+   vec3 diffuse;
+   vec3 specular;
+   sampler2D texture_diffuse1;
+   sampler2D texture_specular1;
+   sampler2D texture_normal1;
+   float shininess;
+};
+
+in vec3 Normal;
+in mat3 TBN;
+in vec3 FragPos;           // defined in world space
+in vec2 TexCoord;
+
+uniform Material material;
+uniform bool useDiffuseColor;
+uniform bool useSpecularColor;
+uniform bool useNormalMap;
+
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gSpecular;
+layout (location = 2) out vec4 gNormal;    // w: shininess
+
+void main()
+{
+   vec3 diffuseColor = useDiffuseColor ? material.diffuse : vec3(texture(material.texture_diffuse1, TexCoord));
+   vec3 specularColor = useSpecularColor ? material.specular : vec3(texture(material.texture_specular1, TexCoord));
+
+   vec3 normal = Normal;
+   if (useNormalMap) {
+      normal.xy = texture(material.texture_normal1, TexCoord).xy * 2.0f - 1.0f;
+      normal.z = sqrt(max(1.0f - dot(normal.xy, normal.xy), 0.0f));
+      normal = normalize(TBN * normal);
+   }
+
+   gAlbedo = vec4(diffuseColor, 1.0f);
+   gSpecular = vec4(specularColor, 1.0f);
+   gNormal = vec4(normal, material.shininess);
+}
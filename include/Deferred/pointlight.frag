@@ -0,0 +1,58 @@
+#version 330 core
+
+layout (std140) uniform Camera {
+   mat4 view;
+   mat4 projection;
+   vec4 viewPos;           // defined in world space
+};
+
+flat in vec4 lightPositionRadius;
+flat in vec4 lightAmbient;     // w: kConstant
+flat in vec4 lightDiffuse;     // w: kLinear
+flat in vec4 lightSpecular;    // w: kQuadratic
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform mat4 invViewProjection;
+uniform vec4 viewport;     // x, y, width, height
+
+out vec4 FragColor;
+
+void main()
+{
+   ivec2 texel = ivec2(gl_FragCoord.xy);
+   float depth = texelFetch(gDepth, texel, 0).r;
+   if (depth == 1.0f)
+      discard;
+
+   vec2 ndc = (gl_FragCoord.xy - viewport.xy) / viewport.zw * 2.0f - 1.0f;
+   vec4 position = invViewProjection * vec4(ndc, depth * 2.0f - 1.0f, 1.0f);
+   vec3 fragPos = position.xyz / position.w;
+
+   vec3 toLight = lightPositionRadius.xyz - fragPos;
+   float lightDist = length(toLight);
+   if (lightDist > lightPositionRadius.w)
+      discard;             // inside the volume on screen, but out of range
+
+   vec3 diffuseColor = texelFetch(gAlbedo, texel, 0).rgb;
+   vec3 specularColor = texelFetch(gSpecular, texel, 0).rgb;
+   vec4 normalShininess = texelFetch(gNormal, texel, 0);
+   vec3 normal = normalShininess.xyz;
+   vec3 viewDir = normalize(viewPos.xyz - fragPos);
+
+   // same terms as calculatePointLight() in Entity/shader.frag
+   vec3 lightDir = toLight / lightDist;
+   float attenuation = 1.0f / (lightAmbient.w + lightDiffuse.w * lightDist + lightSpecular.w * lightDist * lightDist);
+
+   vec3 ambient = diffuseColor * lightAmbient.rgb;
+   vec3 diffuse = max(dot(lightDir, normal), 0.0f) * diffuseColor * lightDiffuse.rgb;
+
+   vec3 reflectDir = reflect(-lightDir, normal);
+   float spec = pow(max(dot(viewDir, reflectDir), 0.0f), normalShininess.w);
+   vec3 specular = spec * specularColor * lightSpecular.rgb;
+
+   FragColor = vec4((ambient + diffuse + specular) * attenuation, 1.0f);
+}
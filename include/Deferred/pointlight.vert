@@ -0,0 +1,31 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;         // unit light volume, see DeferredRenderer::buildSphere()
+
+// per light, see DeferredRenderer::light()
+layout (location = 1) in vec4 aPositionRadius;
+layout (location = 2) in vec4 aAmbient;     // w: kConstant
+layout (location = 3) in vec4 aDiffuse;     // w: kLinear
+layout (location = 4) in vec4 aSpecular;    // w: kQuadratic
+
+layout (std140) uniform Camera {
+   mat4 view;
+   mat4 projection;
+   vec4 viewPos;
+};
+
+flat out vec4 lightPositionRadius;
+flat out vec4 lightAmbient;
+flat out vec4 lightDiffuse;
+flat out vec4 lightSpecular;
+
+void main()
+{
+   lightPositionRadius = aPositionRadius;
+   lightAmbient = aAmbient;
+   lightDiffuse = aDiffuse;
+   lightSpecular = aSpecular;
+
+   vec3 worldPos = aPositionRadius.xyz + aPositionRadius.w * aPos;
+   gl_Position = projection * view * vec4(worldPos, 1.0f);
+}
@@ -0,0 +1,279 @@
+#include "DeferredRenderer.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+#include "Material.hpp"
+#include "UniformBlocks.hpp"
+
+namespace {
+
+    // matches the far plane of Application::projectionMatrix()
+    const float kMaxLightRadius = 100.0f;
+
+    // lighting below this fraction of a light's intensity is left out
+    const float kCutoff = 1.0f / 256.0f;
+
+    const int kInstanceAttributes = 4;  // vec4s per light
+
+    GLuint createTarget(GLenum attachment, GLint internalFormat, GLenum format, GLenum type, int width, int height)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        // read with texelFetch only
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+        return texture;
+    }
+}
+
+DeferredRenderer::DeferredRenderer()
+{
+    _geometryShader    = new Shader("../include/Entity/shader.vert", "../include/Deferred/gbuffer.frag");
+    _directionalShader = new Shader("../include/Deferred/fullscreen.vert", "../include/Deferred/directional.frag");
+    _pointLightShader  = new Shader("../include/Deferred/pointlight.vert", "../include/Deferred/pointlight.frag");
+
+    for (Shader* shader : { _geometryShader, _directionalShader, _pointLightShader }) {
+        shader->bindUniformBlock(ubo::CameraBlockName, ubo::CameraBinding);
+        shader->bindUniformBlock(ubo::LightsBlockName, ubo::LightsBinding);
+    }
+    Material::bindSamplers(*_geometryShader);
+
+    // G-buffer units, shared by both lighting programs
+    for (Shader* shader : { _directionalShader, _pointLightShader }) {
+        shader->use();
+        shader->setInt("gAlbedo"_u, 0);
+        shader->setInt("gSpecular"_u, 1);
+        shader->setInt("gNormal"_u, 2);
+        shader->setInt("gDepth"_u, 3);
+    }
+
+    glGenVertexArrays(1, &_emptyVAO);
+    buildSphere();
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    delete _geometryShader;
+    delete _directionalShader;
+    delete _pointLightShader;
+
+    GLuint textures[] = { _albedoTexture, _specularTexture, _normalTexture, _depthTexture };
+    glDeleteTextures(4, textures);
+    glDeleteFramebuffers(1, &_frameBuffer);
+    glDeleteVertexArrays(1, &_emptyVAO);
+    glDeleteVertexArrays(1, &_sphereVAO);
+    glDeleteBuffers(1, &_sphereVBO);
+    glDeleteBuffers(1, &_sphereEBO);
+    glDeleteBuffers(1, &_instanceVBO);
+}
+
+float DeferredRenderer::lightRadius(const PointLight& light)
+{
+    glm::vec3 color = light.ambient() + light.diffuse() + light.specular();
+    float intensity = std::max(color.r, std::max(color.g, color.b));
+
+    // solve kConstant + kLinear d + kQuadratic d^2 = intensity / cutoff for d
+    float c = light.kConstant() - intensity / kCutoff;
+    if (c >= 0.0f)
+        return 0.0f;
+
+    float a = light.kQuadratic(), b = light.kLinear();
+    float radius;
+    if (a > 0.0f)
+        radius = (-b + std::sqrt(b * b - 4.0f * a * c)) / (2.0f * a);
+    else if (b > 0.0f)
+        radius = -c / b;
+    else
+        radius = kMaxLightRadius;
+    return std::min(radius, kMaxLightRadius);
+}
+
+void DeferredRenderer::resize(int width, int height)
+{
+    if (width <= _width && height <= _height)
+        return;
+    _width = std::max(width, _width);
+    _height = std::max(height, _height);
+
+    if (!_frameBuffer)
+        glGenFramebuffers(1, &_frameBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer);
+
+    GLuint textures[] = { _albedoTexture, _specularTexture, _normalTexture, _depthTexture };
+    glDeleteTextures(4, textures);
+    _albedoTexture   = createTarget(GL_COLOR_ATTACHMENT0, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, _width, _height);
+    _specularTexture = createTarget(GL_COLOR_ATTACHMENT1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, _width, _height);
+    _normalTexture   = createTarget(GL_COLOR_ATTACHMENT2, GL_RGBA16F, GL_RGBA, GL_FLOAT, _width, _height);
+    _depthTexture    = createTarget(GL_DEPTH_ATTACHMENT, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, _width, _height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(3, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "DEFERRED::ERROR: G-buffer of " << _width << "x" << _height << " is incomplete" << std::endl;
+}
+
+void DeferredRenderer::beginGeometry()
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_target);
+    glGetIntegerv(GL_VIEWPORT, _viewport);
+
+    resize(_viewport[0] + _viewport[2], _viewport[1] + _viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, _frameBuffer);
+    glViewport(_viewport[0], _viewport[1], _viewport[2], _viewport[3]);
+
+    // an enabled scissor test limits the clear and the lighting alike
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+}
+
+unsigned int DeferredRenderer::light(const std::vector<PointLight>& lights, const Frustum& frustum, const glm::mat4& viewProjection)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, _target);
+    glViewport(_viewport[0], _viewport[1], _viewport[2], _viewport[3]);
+
+    GLuint textures[] = { _albedoTexture, _specularTexture, _normalTexture, _depthTexture };
+    for (int i = 0; i < 4; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glm::mat4 invViewProjection = glm::inverse(viewProjection);
+    glm::vec4 viewport(_viewport[0], _viewport[1], _viewport[2], _viewport[3]);
+
+    // directional lights over every covered pixel; writing the G-buffer depth into the
+    // target lets the forward passes that follow depth-test against the entities
+    glDepthFunc(GL_ALWAYS);
+    _directionalShader->use();
+    _directionalShader->setMat4("invViewProjection"_u, invViewProjection);
+    _directionalShader->setVec4("viewport"_u, viewport);
+    glBindVertexArray(_emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // one instance of the light volume per point light in view
+    _instances.clear();
+    for (const PointLight& light : lights) {
+        float radius = lightRadius(light);
+        BoundingSphere range;
+        range.center = light.position();
+        range.radius = radius;
+        if (radius <= 0.0f || !frustum.intersects(range))
+            continue;
+
+        _instances.push_back(glm::vec4(range.center, radius));
+        _instances.push_back(glm::vec4(light.ambient(), light.kConstant()));
+        _instances.push_back(glm::vec4(light.diffuse(), light.kLinear()));
+        _instances.push_back(glm::vec4(light.specular(), light.kQuadratic()));
+    }
+    GLsizei count = GLsizei(_instances.size() / kInstanceAttributes);
+
+    if (count > 0) {
+        glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, _instances.size() * sizeof(glm::vec4), _instances.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // back faces behind the surface: shades what lies inside the volume, also with
+        // the camera inside it; depth clamping keeps volumes past the far plane whole
+        glDepthFunc(GL_GEQUAL);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glEnable(GL_DEPTH_CLAMP);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+
+        _pointLightShader->use();
+        _pointLightShader->setMat4("invViewProjection"_u, invViewProjection);
+        _pointLightShader->setVec4("viewport"_u, viewport);
+        glBindVertexArray(_sphereVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, _sphereIndices, GL_UNSIGNED_SHORT, (void*)0, count);
+
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_CLAMP);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+    }
+
+    glDepthFunc(GL_LESS);
+    glBindVertexArray(0);
+    return static_cast<unsigned int>(count);
+}
+
+/**
+ * @brief Icosphere of 80 triangles, grown so its faces enclose the unit sphere: a
+ * light volume of radius r then covers every point within r of the light.
+ */
+void DeferredRenderer::buildSphere()
+{
+    const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+    std::vector<glm::vec3> vertices = {
+        { -1,  t,  0 }, {  1,  t,  0 }, { -1, -t,  0 }, {  1, -t,  0 },
+        {  0, -1,  t }, {  0,  1,  t }, {  0, -1, -t }, {  0,  1, -t },
+        {  t,  0, -1 }, {  t,  0,  1 }, { -t,  0, -1 }, { -t,  0,  1 }
+    };
+    std::vector<GLushort> indices = {
+        0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+        1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+        3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+        4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+    };
+    for (auto& v : vertices)
+        v = glm::normalize(v);
+
+    // split every triangle in four, with the new vertices pushed out onto the sphere
+    std::vector<GLushort> subdivided;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        GLushort a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        GLushort ab = GLushort(vertices.size()), bc = GLushort(ab + 1), ca = GLushort(ab + 2);
+        vertices.push_back(glm::normalize(vertices[a] + vertices[b]));
+        vertices.push_back(glm::normalize(vertices[b] + vertices[c]));
+        vertices.push_back(glm::normalize(vertices[c] + vertices[a]));
+        subdivided.insert(subdivided.end(), { a, ab, ca,   b, bc, ab,   c, ca, bc,   ab, bc, ca });
+    }
+    indices = std::move(subdivided);
+
+    // the faces cut into the sphere; scale out by the closest face distance
+    float inner = 1.0f;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& a = vertices[indices[i]];
+        glm::vec3 normal = glm::normalize(glm::cross(vertices[indices[i + 1]] - a, vertices[indices[i + 2]] - a));
+        inner = std::min(inner, std::abs(glm::dot(normal, a)));
+    }
+    for (auto& v : vertices)
+        v /= inner;
+    _sphereIndices = GLsizei(indices.size());
+
+    glGenVertexArrays(1, &_sphereVAO);
+    glGenBuffers(1, &_sphereVBO);
+    glGenBuffers(1, &_sphereEBO);
+    glGenBuffers(1, &_instanceVBO);
+
+    glBindVertexArray(_sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, _sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+
+    // per light: position and radius, then ambient, diffuse and specular with kConstant, kLinear, kQuadratic
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+    for (int i = 0; i < kInstanceAttributes; i++) {
+        glEnableVertexAttribArray(1 + i);
+        glVertexAttribPointer(1 + i, 4, GL_FLOAT, GL_FALSE, kInstanceAttributes * sizeof(glm::vec4), (void*)(i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(1 + i, 1);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
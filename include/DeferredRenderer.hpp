@@ -0,0 +1,88 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <vector>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include "Bounds.hpp"
+#include "Shader.hpp"
+#include "LightSource/LightSource.hpp"
+
+/**
+ * Deferred shading of entities, for scenes with more point lights than the forward
+ * entity shader's Lights block holds. Entities are drawn once into a G-buffer (albedo,
+ * specular, normal and shininess, depth), then lit into the pass's own target: the
+ * directional lights with one full-screen triangle, which also copies the G-buffer depth
+ * into the target, and every point light whose range is in view as an instanced sphere
+ * covering just that range. Light sources, the skybox and the water are still drawn
+ * forward afterwards and depth-test against the copied depth.
+ *
+ * Works with any target with a depth buffer, so the water reflection and refraction
+ * passes are lit the same way as the main pass.
+ */
+class DeferredRenderer
+{
+    public:
+        DeferredRenderer();
+        ~DeferredRenderer();
+
+        DeferredRenderer(const DeferredRenderer&) = delete;
+        DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+        /* Entity program writing the G-buffer; takes the entity shader's uniforms */
+        Shader* geometryShader() const {
+            return _geometryShader;
+        }
+
+        /**
+         * @brief Remember the bound target and its viewport, then bind and clear the
+         * G-buffer at that size. Entities drawn with geometryShader() until light()
+         * land in the G-buffer.
+         */
+        void beginGeometry();
+
+        /**
+         * @brief Light the G-buffer into the target bound before beginGeometry() and leave
+         * it bound, with its depth buffer holding the entities' depth.
+         *
+         * @param frustum Point lights whose range is outside it are skipped.
+         * @param viewProjection The pass's camera, to rebuild positions from depth.
+         * @return The number of point lights drawn.
+         */
+        unsigned int light(const std::vector<PointLight>& lights, const Frustum& frustum, const glm::mat4& viewProjection);
+
+        /**
+         * @brief Distance at which the light's attenuated contribution drops below 1/256
+         * of full intensity, at most the far plane.
+         */
+        static float lightRadius(const PointLight& light);
+
+    private:
+        void resize(int width, int height);
+        void buildSphere();
+
+    private:
+        Shader* _geometryShader;
+        Shader* _directionalShader;
+        Shader* _pointLightShader;
+
+        GLuint _frameBuffer = 0;
+        GLuint _albedoTexture = 0;      // rgb: diffuse color
+        GLuint _specularTexture = 0;    // rgb: specular color
+        GLuint _normalTexture = 0;      // xyz: world space normal, w: shininess
+        GLuint _depthTexture = 0;
+        int _width = 0, _height = 0;    // only grows, passes use the lower left corner
+
+        GLuint _emptyVAO = 0;           // the full-screen triangle is made up in the vertex shader
+        GLuint _sphereVAO = 0, _sphereVBO = 0, _sphereEBO = 0;
+        GLsizei _sphereIndices = 0;
+        GLuint _instanceVBO = 0;
+        std::vector<glm::vec4> _instances;  // 4 per light, see Deferred/pointlight.vert
+
+        GLint _target = 0;
+        GLint _viewport[4] = {};
+};
+
+#endif // DEFERRED_RENDERER_H
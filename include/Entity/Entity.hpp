@@ -1,42 +1,47 @@
 #ifndef ENTITY_H
 #define ENTITY_H
 
-#include "glm/gtx/transform.hpp"
-#include "glm/gtc/matrix_inverse.hpp"
+#include "glm/glm.hpp"
 #include "Model.hpp"
+#include "ResourceManager.hpp"
 #include "Shader.hpp"
+#include "RenderQueue.hpp"
+#include "TransformStore.hpp"
 
 class Entity
 {
     public:
 
-        Entity(const std::string& path, bool translateToOrigin = true) {
-            _model = new Model(path.c_str());
-            _toOrigin = translateToOrigin ? glm::translate(-_model->centroid()) : glm::mat4(1.0f);
-        }
+        Entity(const std::string& path, bool translateToOrigin = true)
+            : Entity(ResourceManager::instance().acquireModel(path), translateToOrigin) {}
+
+        /* Place an already loaded model, e.g. one streamed in by SceneStreamer */
+        Entity(std::shared_ptr<Model> model, bool translateToOrigin = true)
+            : _model(std::move(model)),
+              _transform(translateToOrigin ? -_model->centroid() : glm::vec3(0.0f)) {}
 
         void translate(glm::vec3 t) {
-            _translation += t;
+            _transform.translate(t);
         }
 
         void rotateX(float degrees) {
-            _rotation.x += degrees;
+            _transform.rotate(glm::vec3(degrees, 0.0f, 0.0f));
         }
 
         void rotateY(float degrees) {
-            _rotation.y += degrees;
+            _transform.rotate(glm::vec3(0.0f, degrees, 0.0f));
         }
 
         void rotateZ(float degrees) {
-            _rotation.z += degrees;
+            _transform.rotate(glm::vec3(0.0f, 0.0f, degrees));
         }
 
         void scale(glm::vec3 s) {
-            _scale *= s;
+            _transform.scale(s);
         }
 
         void scale(float s) {
-            _scale *= s;
+            _transform.scale(glm::vec3(s));
         }
 
         void draw(Shader* shader) {
@@ -44,44 +49,57 @@ class Entity
             _model->draw(*shader);
         }
 
-        void setShaderUniforms(Shader* shader);
-        void setTexCoordScale(float f) {
-            _texCoordScale = f;
+        /**
+         * @brief Queue every mesh for a sorted draw; uniforms are applied by the queue.
+         *
+         * Expects TransformStore::update() to have run this frame. Visibility is
+         * decided by the caller, see RenderList.
+         *
+         * @param flags Extra RenderQueue::SubmitFlags, e.g. ClipPlane.
+         * @param lodScale Picks the level of detail of each mesh, see RenderList::submit().
+         */
+        void submit(RenderQueue& queue, Shader* shader, unsigned int flags = 0, float lodScale = FLT_MAX) {
+            queue.submit(shader, *_model, &_transform.uniforms(), RenderQueue::UseMaterial | RenderQueue::Instanced | flags, lodScale);
         }
 
-    private:
-        Model* _model;
+        /* World-space bounds as of the last TransformStore::update() */
+        AABB worldBounds() const {
+            return _model->bounds().transformed(_transform.uniforms().model);
+        }
+
+        BoundingSphere worldBoundingSphere() const {
+            return _model->boundingSphere().transformed(_transform.uniforms().model);
+        }
 
-        glm::mat4 _toOrigin;
-        glm::vec3 _translation = glm::vec3(0.0f);
-        glm::vec3 _rotation = glm::vec3(0.0f);
-        glm::vec3 _scale = glm::vec3(1.0f);
+        /* World units per object-space unit, at most */
+        float worldScale() const {
+            return maxScale(_transform.uniforms().model);
+        }
 
-        float _texCoordScale = 1.0f;
+        void setShaderUniforms(Shader* shader);
+        void setTexCoordScale(float f) {
+            _transform.uniforms().texCoordScale = f;
+        }
 
+    private:
+        std::shared_ptr<Model> _model;
+        Transform _transform;
 };
 
-void Entity::setShaderUniforms(Shader* shader)
+inline void Entity::setShaderUniforms(Shader* shader)
 {
-
-    glm::mat4 translation = glm::translate(_translation);
-
-    const glm::vec3 xAxis(1.0f, 0.0f, 0.0f);
-    const glm::vec3 yAxis(0.0f, 1.0f, 0.0f);
-    const glm::vec3 zAxis(0.0f, 0.0f, 1.0f);
-
-    glm::mat4 rotX = glm::rotate(glm::radians(_rotation.x), xAxis);
-    glm::mat4 rotY = glm::rotate(glm::radians(_rotation.y), yAxis);
-    glm::mat4 rotZ = glm::rotate(glm::radians(_rotation.z), zAxis);
-
-    glm::mat4 rotation = rotZ * rotY * rotX;
-    glm::mat4 scale = glm::scale(_scale);
-    glm::mat4 modelMat = translation * rotation * scale * _toOrigin;
-    glm::mat4 invTransposeModelMat = glm::inverseTranspose(modelMat);
-
-    shader->setMat4("model", modelMat);
-    shader->setMat4("invTransposeModel", invTransposeModelMat);
-    shader->setFloat("texCoordScale", _texCoordScale);
+    // outside of a frame's batch update, e.g. a one-off draw after a move
+    TransformStore::instance().update();
+    const ObjectUniforms& object = _transform.uniforms();
+
+    // the entity shader reads per-object data as instance attributes; outside of the
+    // render queue they are supplied as constant attribute values
+    InstanceData instance;
+    instance.model = object.model;
+    for (int i = 0; i < 3; i++)
+        instance.invTransposeModel[i] = glm::vec3(object.invTransposeModel[i]);
+    instance.texCoordScale = object.texCoordScale;
+    instance.setGeneric();
 }
 
 #endif 
\ No newline at end of file
@@ -10,20 +10,19 @@ struct Material {
    float shininess;
 };
 
+// std140: each vec3 shares a 16-byte slot with the float that follows it
 struct PointLight {
    vec3 position;          // defined in world space
-   vec3 ambient;
-   vec3 diffuse;
-   vec3 specular;
-
    float kConstant;
+   vec3 ambient;
    float kLinear;
+   vec3 diffuse;
    float kQuadratic;
+   vec3 specular;
 };
 
 struct DirectionalLight {
    vec3 direction;         // defined in world space
-
    vec3 ambient;
    vec3 diffuse;
    vec3 specular;
@@ -35,15 +34,23 @@ in vec3 FragPos;           // defined in world space
 in vec2 TexCoord;
 in vec4 color;
 
+// must match ubo::MaxPointLights / ubo::MaxDirLights in UniformBlocks.hpp
 #define MAX_NUM_POINT_LIGHTS 4
-uniform int numPointLights;
-uniform PointLight pointLights[MAX_NUM_POINT_LIGHTS];
-
 #define MAX_NUM_DIR_LIGHTS 1
-uniform int numDirLights;
-uniform DirectionalLight dirLights[MAX_NUM_DIR_LIGHTS];
 
-uniform vec3 viewPos;      // defined in world space 
+layout (std140) uniform Lights {
+   PointLight pointLights[MAX_NUM_POINT_LIGHTS];
+   DirectionalLight dirLights[MAX_NUM_DIR_LIGHTS];
+   int numPointLights;
+   int numDirLights;
+};
+
+layout (std140) uniform Camera {
+   mat4 view;
+   mat4 projection;
+   vec4 viewPos;           // defined in world space
+};
+
 uniform Material material;
 uniform bool useDiffuseColor;
 uniform bool useSpecularColor;
@@ -88,14 +95,15 @@ vec3 calculatePointLight(PointLight light, vec3 viewDir, vec3 normal, vec3 diffu
 
 void main()
 {
-   vec3 viewDir = normalize(viewPos - FragPos);
+   vec3 viewDir = normalize(viewPos.xyz - FragPos);
    vec3 diffuseColor = useDiffuseColor ? material.diffuse : vec3(texture(material.texture_diffuse1, TexCoord));
    vec3 specularColor = useSpecularColor ? material.specular : vec3(texture(material.texture_specular1, TexCoord));
 
    vec3 normal = Normal;
    if (useNormalMap) {
-      normal = texture(material.texture_normal1, TexCoord).xyz;
-      normal = normal * 2.0f - 1.0f;
+      // z is rebuilt from x and y, which is all a BC5 compressed normal map stores
+      normal.xy = texture(material.texture_normal1, TexCoord).xy * 2.0f - 1.0f;
+      normal.z = sqrt(max(1.0f - dot(normal.xy, normal.xy), 0.0f));
       normal = normalize(TBN * normal);
    }
 
@@ -1,33 +1,58 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+// either Vertex or PackedVertex, see Mesh.hpp
+layout (location = 0) in vec4 aPos;         // packed: w is the bitangent handedness, 0 = flipped
+layout (location = 1) in vec3 aNormal;      // packed: octahedral in xy
 layout (location = 2) in vec2 aTexCoord;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+layout (location = 3) in vec3 aTangent;     // packed: octahedral in xy
+layout (location = 4) in vec3 aBitangent;   // not set for packed vertices
 
-uniform mat4 model;
-uniform mat4 invTransposeModel;
-uniform mat4 view;
-uniform mat4 projection;
-uniform vec4 reflectionClippingPlane;
+// per instance, see InstanceData in Mesh.hpp
+layout (location = 5) in mat4 model;
+layout (location = 9) in mat3 invTransposeModel;
+layout (location = 12) in float texCoordScale;  // shrink or magnify texture (useful for textures that wrap)
+
+// per mesh, see Mesh::applyVertexDecode()
+layout (location = 13) in vec3 positionOffset;
+layout (location = 14) in vec4 positionScale;   // w: 1 for packed vertices
 
-uniform float texCoordScale;  // shrink or magnify texture (useful for textures that wrap)
+layout (std140) uniform Camera {
+   mat4 view;
+   mat4 projection;
+   vec4 viewPos;
+};
+
+uniform vec4 reflectionClippingPlane;
 
 out vec3 Normal;
 out mat3 TBN;
 out vec3 FragPos;
 out vec2 TexCoord;
 
+vec3 octDecode(vec2 e)
+{
+   vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+   if (v.z < 0.0)
+      v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+   return normalize(v);
+}
+
 void main()
 {
-   Normal = normalize(mat3(invTransposeModel) * aNormal);   // computed in world space
-   vec3 Tangent = normalize(mat3(invTransposeModel) * aTangent);
-   vec3 Bitangent = normalize(mat3(invTransposeModel) * aBitangent);
+   vec3 normal = aNormal, tangent = aTangent, bitangent = aBitangent;
+   if (positionScale.w > 0.0) {
+      normal = octDecode(aNormal.xy);
+      tangent = octDecode(aTangent.xy);
+      bitangent = cross(normal, tangent) * (aPos.w > 0.5 ? 1.0 : -1.0);
+   }
+
+   Normal = normalize(invTransposeModel * normal);   // computed in world space
+   vec3 Tangent = normalize(invTransposeModel * tangent);
+   vec3 Bitangent = normalize(invTransposeModel * bitangent);
    TBN = mat3(Tangent, Bitangent, Normal);
 
    TexCoord = aTexCoord * texCoordScale;
-   vec4 worldPos = model * vec4(aPos, 1.0f);
+   vec4 worldPos = model * vec4(positionOffset + positionScale.xyz * aPos.xyz, 1.0f);
    gl_ClipDistance[0] = dot(worldPos, reflectionClippingPlane);
    FragPos = worldPos.xyz;                                  // computed in world space
    gl_Position = projection * view * worldPos;
@@ -0,0 +1,120 @@
+#include "GpuTimer.hpp"
+
+#include <iostream>
+
+#include "Profiler.hpp"
+
+GpuTimer::~GpuTimer()
+{
+    release();
+}
+
+bool GpuTimer::init()
+{
+    _supported = GLAD_GL_VERSION_3_3 != 0;
+
+    // software rasterizers may expose the entry points with a zero bit counter
+    if (_supported) {
+        GLint bits = 0;
+        glGetQueryiv(GL_TIME_ELAPSED, GL_QUERY_COUNTER_BITS, &bits);
+        _supported = bits > 0;
+    }
+
+    if (!_supported)
+        std::cout << "GPUTIMER::INFO: Timer queries are not supported, GPU pass times are not measured" << std::endl;
+    return _supported;
+}
+
+void GpuTimer::release()
+{
+    for (Frame& frame : _frames) {
+        if (!frame.queries.empty())
+            glDeleteQueries(static_cast<GLsizei>(frame.queries.size()), frame.queries.data());
+        frame.queries.clear();
+        frame.zones.clear();
+        frame.resumed.clear();
+        frame.used = 0;
+    }
+    _supported = _active = false;
+}
+
+void GpuTimer::beginFrame()
+{
+    _stack.clear();
+    _active = _supported && Profiler::enabled();
+    if (!_active)
+        return;
+
+    _current ^= 1;
+    collect(_frames[_current]);
+}
+
+void GpuTimer::collect(Frame& frame)
+{
+    if (frame.used == 0)
+        return;
+
+    // queries finish in order, so the last one being available means they all are
+    GLint available = 0;
+    glGetQueryObjectiv(frame.queries[frame.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (!available) {
+        _droppedFrames++;
+        frame.used = 0;
+        return;
+    }
+
+    _results.resize(frame.used);
+    bool plausible = true;
+    for (size_t i = 0; i < frame.used; i++) {
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &_results[i]);
+        // llvmpipe returns a bogus time for the first query that contains work
+        plausible = plausible && _results[i] < MaxPlausibleNs;
+    }
+
+    if (plausible) {
+        for (size_t i = 0; i < frame.used; i++)
+            Profiler::instance().addZoneTime(frame.zones[i], _results[i], !frame.resumed[i]);
+    } else {
+        _droppedFrames++;
+    }
+    frame.used = 0;
+}
+
+void GpuTimer::beginQuery(const char* name, bool resumed)
+{
+    Frame& frame = _frames[_current];
+    if (frame.used == frame.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+        frame.zones.push_back(name);
+        frame.resumed.push_back(resumed);
+    } else {
+        frame.zones[frame.used] = name;
+        frame.resumed[frame.used] = resumed;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.used++]);
+}
+
+void GpuTimer::push(const char* name)
+{
+    if (!_active)
+        return;
+
+    if (!_stack.empty())
+        glEndQuery(GL_TIME_ELAPSED);
+    _stack.push_back(name);
+    beginQuery(name, false);
+}
+
+void GpuTimer::pop()
+{
+    if (!_active || _stack.empty())
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    _stack.pop_back();
+    if (!_stack.empty())
+        beginQuery(_stack.back(), true);
+}
@@ -0,0 +1,93 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <vector>
+#include <cstddef>
+
+#include "glad/glad.h"
+
+/**
+ * GPU time of render passes, measured with GL_TIME_ELAPSED queries. Zones may nest:
+ * GL_TIME_ELAPSED queries cannot, so opening an inner zone ends the outer zone's query
+ * and closing it starts a new one, and every zone reports its exclusive time. A zone
+ * split this way still counts as one call.
+ *
+ * Queries are double-buffered per frame. A frame's results are read one frame late,
+ * when its buffer is reused, and only if the GPU has finished them, so reading never
+ * stalls. They are added to the Profiler's zone averages and are only measured while
+ * the profiler is enabled. Without timer query support every call does nothing.
+ */
+class GpuTimer
+{
+    public:
+        GpuTimer() = default;
+        ~GpuTimer();
+
+        GpuTimer(const GpuTimer&) = delete;
+        GpuTimer& operator=(const GpuTimer&) = delete;
+
+        /* Check for timer query support; call once the GL context is current */
+        bool init();
+
+        bool supported() const {
+            return _supported;
+        }
+
+        /* Collect the results of the frame that last used this frame's queries */
+        void beginFrame();
+
+        /* Start a zone; name must be a string literal like Profiler zone names */
+        void push(const char* name);
+        void pop();
+
+        /* Frames whose results were still pending when their queries were reused, or implausible */
+        unsigned long droppedFrames() const {
+            return _droppedFrames;
+        }
+
+        /* Delete the queries while the context is still alive */
+        void release();
+
+    private:
+        struct Frame {
+            std::vector<GLuint> queries;
+            std::vector<const char*> zones;     // zone of each query
+            std::vector<char> resumed;          // query continues its zone after a nested zone
+            size_t used = 0;
+        };
+
+        void collect(Frame& frame);
+        void beginQuery(const char* name, bool resumed);
+
+    private:
+        static constexpr GLuint64 MaxPlausibleNs = 1000000000;    // longer passes are driver bugs
+
+        bool _supported = false;
+        bool _active = false;                   // measuring the current frame
+        Frame _frames[2];
+        unsigned int _current = 0;
+        std::vector<const char*> _stack;
+        std::vector<GLuint64> _results;
+        unsigned long _droppedFrames = 0;
+};
+
+/* RAII zone on a GpuTimer */
+class GpuZone
+{
+    public:
+        GpuZone(GpuTimer& timer, const char* name) : _timer(timer) {
+            _timer.push(name);
+        }
+
+        ~GpuZone() {
+            _timer.pop();
+        }
+
+        GpuZone(const GpuZone&) = delete;
+        GpuZone& operator=(const GpuZone&) = delete;
+
+    private:
+        GpuTimer& _timer;
+};
+
+#endif // GPU_TIMER_H
@@ -2,9 +2,11 @@
 #define LIGHT_H
 
 #include "glm/glm.hpp"
-#include "glm/gtc/matrix_inverse.hpp"
 #include "Shader.hpp"
 #include "Model.hpp"
+#include "RenderQueue.hpp"
+#include "ResourceManager.hpp"
+#include "TransformStore.hpp"
 
 // too small to make into a class
 struct DirLight
@@ -64,9 +66,10 @@ class PointLight
     public:
 
         PointLight(const std::string& path, bool translateToOrigin = true); 
+        PointLight(std::shared_ptr<Model> model, bool translateToOrigin = true);
 
         glm::vec3 position() const {
-            return _position + _translation;
+            return _position + _transform.translation();
         }
         glm::vec3 ambient() const {
             return _ambient;
@@ -93,7 +96,7 @@ class PointLight
         }
 
         void translate(const glm::vec3& t) {
-            _translation += t;
+            _transform.translate(t);
         }
 
         void setAmbient(const glm::vec3& color) {
@@ -102,6 +105,7 @@ class PointLight
 
         void setDiffuse(const glm::vec3& color) {
             _diffuse = color;
+            _transform.uniforms().color = color;
         }
 
         void setSpecular(const glm::vec3& color) {
@@ -121,11 +125,35 @@ class PointLight
         }
 
         void scale(const glm::vec3 s) {
-            _scale *= s;
+            _transform.scale(s);
         }
 
         void draw(Shader* shader);
 
+        /**
+         * @brief Queue the light's meshes for a sorted draw; the light shader ignores materials.
+         *
+         * @param flags Extra RenderQueue::SubmitFlags, e.g. ClipPlane.
+         * @param lodScale Picks the level of detail of each mesh, see RenderList::submit().
+         */
+        void submit(RenderQueue& queue, Shader* shader, unsigned int flags = 0, float lodScale = FLT_MAX) {
+            queue.submit(shader, *_model, &_transform.uniforms(), flags, lodScale);
+        }
+
+        /* World-space bounds as of the last TransformStore::update() */
+        AABB worldBounds() const {
+            return _model->bounds().transformed(_transform.uniforms().model);
+        }
+
+        BoundingSphere worldBoundingSphere() const {
+            return _model->boundingSphere().transformed(_transform.uniforms().model);
+        }
+
+        /* World units per object-space unit, at most */
+        float worldScale() const {
+            return maxScale(_transform.uniforms().model);
+        }
+
         void setShaderUniforms(Shader* shader);
         
 
@@ -133,41 +161,41 @@ class PointLight
 
         GLuint _VAO, _VBO;
         glm::mat4 _modelMat;
-        Model* _model;
+        std::shared_ptr<Model> _model;
+        Transform _transform;
 
         glm::vec3 _ambient, _diffuse, _specular;
         glm::vec3 _position;
         float _kConstant = 1.0f, _kLinear = 0.7f, _kQuadratic = 1.8;    // arbitrary values
 
-        glm::mat4 _toOrigin;
-        glm::vec3 _translation;
-        glm::vec3 _scale = glm::vec3(1.0f);
 };
 
-PointLight::PointLight(const std::string& path, bool translateToOrigin /* = true */) { 
+inline PointLight::PointLight(const std::string& path, bool translateToOrigin /* = true */)
+    : PointLight(ResourceManager::instance().acquireModel(path), translateToOrigin)
+{ 
+}
+
+inline PointLight::PointLight(std::shared_ptr<Model> model, bool translateToOrigin /* = true */)
+    : _model(std::move(model)),
+      _transform(translateToOrigin ? -_model->centroid() : glm::vec3(0.0f))
+{ 
     _position = glm::vec3(0.0f);
-    _model = new Model(path.c_str());
-    _toOrigin = translateToOrigin ? glm::translate(-_model->centroid()) : glm::mat4(1.0f);
 }
 
-void PointLight::draw(Shader* shader)
+inline void PointLight::draw(Shader* shader)
 {
     setShaderUniforms(shader);
     _model->draw(*shader);
 }
 
-void PointLight::setShaderUniforms(Shader* shader)
+inline void PointLight::setShaderUniforms(Shader* shader)
 {
+    TransformStore::instance().update();
+    const ObjectUniforms& object = _transform.uniforms();
 
-    shader->setVec3("color", _diffuse);
-    
-    glm::mat4 translation = glm::translate(_translation);
-    glm::mat4 scale = glm::scale(_scale);
-    glm::mat4 modelMat = translation * scale * _toOrigin;
-
-    shader->setMat4("model", modelMat);
-    glm::mat4 invTransposeModelMat = glm::inverseTranspose(modelMat);
-    shader->setMat4("invTransposeModel", invTransposeModelMat);
+    shader->setVec3("color"_u, object.color);
+    shader->setMat4("model"_u, object.model);
+    shader->setMat4("invTransposeModel"_u, object.invTransposeModel);
 }
 
 
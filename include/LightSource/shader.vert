@@ -2,17 +2,25 @@
 
 layout (location = 0) in vec3 aPos;
 
+// per mesh, see Mesh::applyVertexDecode()
+layout (location = 13) in vec3 positionOffset;
+layout (location = 14) in vec4 positionScale;
+
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
+
 uniform vec3 color;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform vec4 reflectionClippingPlane;
 
 out vec3 fColor;
 
 void main()
 {
-    vec4 worldPos = model * vec4(aPos, 1.0f);
+    vec4 worldPos = model * vec4(positionOffset + positionScale.xyz * aPos, 1.0f);
     gl_ClipDistance[0] = dot(reflectionClippingPlane, worldPos);
     gl_Position = projection * view * worldPos; 
     fColor = color;
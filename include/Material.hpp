@@ -0,0 +1,84 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <vector>
+#include <cstdint>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include "Shader.hpp"
+
+/**
+ * Compact, precomputed material state of a mesh. Built once at load time so drawing
+ * never has to inspect texture type strings. Every distinct material is interned
+ * and given a small id, which the render queue uses to sort and skip redundant
+ * material changes.
+ */
+struct Material {
+    enum Flags : uint32_t {
+        UseDiffuseColor  = 1 << 0,     // no diffuse map, use the constant color
+        UseSpecularColor = 1 << 1,     // no specular map, use the constant color
+        UseNormalMap     = 1 << 2
+    };
+
+    // fixed texture units, bound to material.texture_*1 once per shader by bindSamplers()
+    enum Unit : GLint {
+        DiffuseUnit = 0,
+        SpecularUnit = 1,
+        NormalUnit = 2
+    };
+
+    uint32_t flags = UseDiffuseColor | UseSpecularColor;
+    GLuint diffuseMap = 0;
+    GLuint specularMap = 0;
+    GLuint normalMap = 0;
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    glm::vec3 specular = glm::vec3(0.0f);
+    float shininess = 0.0f;
+
+    bool operator==(const Material& o) const {
+        return flags == o.flags && diffuseMap == o.diffuseMap && specularMap == o.specularMap
+            && normalMap == o.normalMap && diffuse == o.diffuse && specular == o.specular
+            && shininess == o.shininess;
+    }
+
+    /* Set material uniforms and bind textures on the currently used shader */
+    void apply(const Shader& shader) const {
+        shader.setBool("useDiffuseColor"_u, (flags & UseDiffuseColor) != 0);
+        shader.setBool("useSpecularColor"_u, (flags & UseSpecularColor) != 0);
+        shader.setBool("useNormalMap"_u, (flags & UseNormalMap) != 0);
+        shader.setVec3("material.diffuse"_u, diffuse);
+        shader.setVec3("material.specular"_u, specular);
+        shader.setFloat("material.shininess"_u, shininess);
+
+        glActiveTexture(GL_TEXTURE0 + DiffuseUnit);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        glActiveTexture(GL_TEXTURE0 + SpecularUnit);
+        glBindTexture(GL_TEXTURE_2D, specularMap);
+        glActiveTexture(GL_TEXTURE0 + NormalUnit);
+        glBindTexture(GL_TEXTURE_2D, normalMap);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    /* Point the material samplers at their fixed units. Call once per program. */
+    static void bindSamplers(Shader& shader) {
+        shader.use();
+        shader.setInt("material.texture_diffuse1"_u, DiffuseUnit);
+        shader.setInt("material.texture_specular1"_u, SpecularUnit);
+        shader.setInt("material.texture_normal1"_u, NormalUnit);
+    }
+
+    /* Return the id shared by every material equal to m */
+    static uint32_t intern(const Material& m) {
+        static std::vector<Material> materials;
+        for (uint32_t i = 0; i < materials.size(); i++) {
+            if (materials[i] == m)
+                return i;
+        }
+        materials.push_back(m);
+        return static_cast<uint32_t>(materials.size() - 1);
+    }
+};
+
+#endif // MATERIAL_H
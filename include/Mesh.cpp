@@ -1,16 +1,147 @@
 #include "Mesh.hpp"
 
+#include <cmath>
+
+#include "glm/gtc/packing.hpp"
+
+namespace {
+    VertexFormat gVertexFormat = VertexFormat::Full;
+
+    glm::vec2 signNotZero(const glm::vec2& v) {
+        return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    /* Map a direction onto the octahedron unfolded into [-1, 1]^2 */
+    glm::vec2 octEncode(const glm::vec3& n) {
+        float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (l1 == 0.0f)
+            return glm::vec2(0.0f);
+
+        glm::vec2 p = glm::vec2(n) / l1;
+        if (n.z < 0.0f)
+            p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+        return p;
+    }
+
+    int16_t snorm16(float f) {
+        return static_cast<int16_t>(std::round(glm::clamp(f, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    uint16_t unorm16(float f) {
+        return static_cast<uint16_t>(std::round(glm::clamp(f, 0.0f, 1.0f) * 65535.0f));
+    }
+}
+
+PackedVertex PackedVertex::pack(const Vertex& v, const glm::vec3& offset, const glm::vec3& scale)
+{
+    PackedVertex p;
+    for (int i = 0; i < 3; i++)
+        p.position[i] = scale[i] > 0.0f ? unorm16((v.Position[i] - offset[i]) / scale[i]) : 0;
+
+    // the shader rebuilds the bitangent as cross(normal, tangent) * handedness
+    bool flipped = glm::dot(glm::cross(v.Normal, v.Tangent), v.Bitangent) < 0.0f;
+    p.position[3] = flipped ? 0 : 65535;
+
+    glm::vec2 n = octEncode(v.Normal), t = octEncode(v.Tangent);
+    p.normal[0] = snorm16(n.x);
+    p.normal[1] = snorm16(n.y);
+    p.tangent[0] = snorm16(t.x);
+    p.tangent[1] = snorm16(t.y);
+
+    p.texCoords[0] = glm::packHalf1x16(v.TexCoords.x);
+    p.texCoords[1] = glm::packHalf1x16(v.TexCoords.y);
+    return p;
+}
+
+void Mesh::setVertexFormat(VertexFormat format)
+{
+    gVertexFormat = format;
+}
+
+VertexFormat Mesh::vertexFormat()
+{
+    return gVertexFormat;
+}
+
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
-    : _vertices(vertices), _indices(indices), _textures(textures)
 {
-    setupMesh();
+    setupLods(indices.size(), nullptr, 0);
+    setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
+    setupMaterial(textures, glm::vec3(0.0f), glm::vec3(0.0f), 0.0f);
 }
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
             glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess)
-    : _vertices(vertices), _indices(indices), _textures(textures), _diffuse(diffuseColor), _specular(specularColor), _shininess(shininess)
 {
-    setupMesh();
+    setupLods(indices.size(), nullptr, 0);
+    setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size());
+    setupMaterial(textures, diffuseColor, specularColor, shininess);
+}
+
+Mesh::Mesh(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices,
+            std::vector<Texture> textures, glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess,
+            const MeshLod* lods, size_t numLods)
+{
+    setupLods(numIndices, lods, numLods);
+    setupMesh(vertices, numVertices, indices, numIndices);
+    setupMaterial(textures, diffuseColor, specularColor, shininess);
+}
+
+/**
+ * @brief Resolve texture types into material flags and texture ids once, so
+ * drawing never compares type strings. The shader samples only the first
+ * texture of each type.
+ */
+void Mesh::setupMaterial(const std::vector<Texture>& textures, glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess)
+{
+    _material.diffuse = diffuseColor;
+    _material.specular = specularColor;
+    _material.shininess = shininess;
+
+    for (auto it = textures.rbegin(); it != textures.rend(); ++it) {
+        if (it->type == "texture_diffuse") {
+            _material.diffuseMap = it->id;
+            _material.flags &= ~Material::UseDiffuseColor;
+        } else if (it->type == "texture_specular") {
+            _material.specularMap = it->id;
+            _material.flags &= ~Material::UseSpecularColor;
+        } else if (it->type == "texture_normal") {
+            _material.normalMap = it->id;
+            _material.flags |= Material::UseNormalMap;
+        }
+    }
+
+    _materialId = Material::intern(_material);
+}
+
+void Mesh::setupLods(size_t numIndices, const MeshLod* lods, size_t numLods)
+{
+    if (numLods == 0)
+        _lods.push_back({ 0, static_cast<uint32_t>(numIndices), 0.0f });
+    else
+        _lods.assign(lods, lods + numLods);
+}
+
+/**
+ * @brief Compute the object-space AABB and a bounding sphere centered on it
+ */
+void Mesh::computeBounds(const Vertex* vertices, size_t numVertices)
+{
+    for (size_t i = 0; i < numVertices; i++)
+        _bounds.expand(vertices[i].Position);
+
+    if (_bounds.empty())
+        return;
+
+    float radius2 = 0.0f;
+    glm::vec3 center = _bounds.center();
+    for (size_t i = 0; i < numVertices; i++) {
+        glm::vec3 d = vertices[i].Position - center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+
+    _sphere.center = center;
+    _sphere.radius = std::sqrt(radius2);
 }
 
 /**
@@ -18,8 +149,11 @@ Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std:
  * normals, texture coords to VBO
  * 
  */
-void Mesh::setupMesh()
+void Mesh::setupMesh(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices)
 {
+    _numIndices = numIndices;
+    computeBounds(vertices, numVertices);
+
     glGenVertexArrays(1, &_VAO);
     glGenBuffers(1, &_VBO);
     glGenBuffers(1, &_EBO);
@@ -27,12 +161,39 @@ void Mesh::setupMesh()
     glBindVertexArray(_VAO);
     glBindBuffer(GL_ARRAY_BUFFER, _VBO);
 
-    glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(Vertex), _vertices.data(), GL_STATIC_DRAW);  
+    _packed = gVertexFormat == VertexFormat::Packed && !_bounds.empty();
+    if (_packed) {
+        // quantize positions within the bounds
+        _positionOffset = _bounds.min;
+        _positionScale = _bounds.max - _bounds.min;
+
+        std::vector<PackedVertex> packed(numVertices);
+        for (size_t i = 0; i < numVertices; i++)
+            packed[i] = PackedVertex::pack(vertices[i], _positionOffset, _positionScale);
+
+        _vertexBytes = numVertices * sizeof(PackedVertex);
+        glBufferData(GL_ARRAY_BUFFER, _vertexBytes, packed.data(), GL_STATIC_DRAW);
+        setupPackedAttributes();
+    } else {
+        _vertexBytes = numVertices * sizeof(Vertex);
+        glBufferData(GL_ARRAY_BUFFER, _vertexBytes, vertices, GL_STATIC_DRAW);
+        setupFullAttributes();
+    }
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(unsigned int), 
-                 _indices.data(), GL_STATIC_DRAW);
+    if (numVertices < 65536) {
+        std::vector<uint16_t> shortIndices(indices, indices + numIndices);
+        _indexType = GL_UNSIGNED_SHORT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(uint16_t), 
+                     shortIndices.data(), GL_STATIC_DRAW);
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(unsigned int), 
+                     indices, GL_STATIC_DRAW);
+    }
+}
 
+void Mesh::setupFullAttributes()
+{
     // vertex positions
     glEnableVertexAttribArray(0);	
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
@@ -53,59 +214,87 @@ void Mesh::setupMesh()
     glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 }
 
-void Mesh::draw(Shader& shader)
+/**
+ * @brief Same locations as setupFullAttributes(), normalized to [0, 1] or [-1, 1];
+ * the vertex shaders decode them. Location 4 stays disabled, the bitangent is rebuilt.
+ */
+void Mesh::setupPackedAttributes()
 {
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
 
-    auto is_diffuse = [](Texture t) { return t.type == "texture_diffuse"; };
-    auto is_specular = [](Texture t) { return t.type == "texture_specular"; };
-    auto is_normal = [](Texture t) { return t.type == "texture_normal"; };
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
 
-    if (std::find_if(_textures.begin(), _textures.end(), is_diffuse) == _textures.end()) {
-        shader.setBool("useDiffuseColor", true);
-        shader.setVec3("material.diffuse", _diffuse);
-    } else {
-        shader.setBool("useDiffuseColor", false);
-    }
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
 
-    if (std::find_if(_textures.begin(), _textures.end(), is_specular) == _textures.end()) {
-        shader.setBool("useSpecularColor", true);
-        shader.setVec3("material.specular", _specular);
-    } else {
-        shader.setBool("useSpecularColor", true);
-    }
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+}
 
-    if (std::find_if(_textures.begin(), _textures.end(), is_normal) == _textures.end()) {
-        shader.setBool("useNormalMap", false);
-    } else {
-        shader.setBool("useNormalMap", true);
+void Mesh::applyVertexDecode() const
+{
+    glVertexAttrib3fv(PositionOffsetLocation, &_positionOffset[0]);
+    glVertexAttrib4f(PositionScaleLocation, _positionScale.x, _positionScale.y, _positionScale.z, _packed ? 1.0f : 0.0f);
+}
+
+void Mesh::release()
+{
+    glDeleteBuffers(1, &_VBO);
+    glDeleteBuffers(1, &_EBO);
+    glDeleteVertexArrays(1, &_VAO);
+}
+
+void InstanceData::setGeneric() const
+{
+    for (GLuint i = 0; i < 4; i++)
+        glVertexAttrib4fv(ModelLocation + i, &model[i][0]);
+    for (GLuint i = 0; i < 3; i++)
+        glVertexAttrib3fv(InvTransposeModelLocation + i, &invTransposeModel[i][0]);
+    glVertexAttrib1f(TexCoordScaleLocation, texCoordScale);
+}
+
+void Mesh::bindInstanceAttributes(GLuint buffer, size_t offset) const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    for (GLuint i = 0; i < 4; i++) {
+        GLuint location = InstanceData::ModelLocation + i;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(offset + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(location, 1);
     }
 
-    shader.setFloat("material.shininess", _shininess);
-
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
-    unsigned int normalNr = 1;
-
-    for(unsigned int i = 0; i < _textures.size(); i++)
-    {
-        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-        // retrieve texture number (the N in diffuse_textureN)
-        std::string number;
-        std::string name = _textures[i].type;
-        if(name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if(name == "texture_specular")
-            number = std::to_string(specularNr++);
-        else if (name == "texture_normal")
-            number = std::to_string(normalNr++);
-
-        shader.setInt(("material." + name + number).c_str(), i);
-        glBindTexture(GL_TEXTURE_2D, _textures[i].id);
+    for (GLuint i = 0; i < 3; i++) {
+        GLuint location = InstanceData::InvTransposeModelLocation + i;
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(offset + offsetof(InstanceData, invTransposeModel) + i * sizeof(glm::vec3)));
+        glVertexAttribDivisor(location, 1);
     }
-    glActiveTexture(GL_TEXTURE0);
 
-    // draw mesh
+    glEnableVertexAttribArray(InstanceData::TexCoordScaleLocation);
+    glVertexAttribPointer(InstanceData::TexCoordScaleLocation, 1, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*)(offset + offsetof(InstanceData, texCoordScale)));
+    glVertexAttribDivisor(InstanceData::TexCoordScaleLocation, 1);
+}
+
+void Mesh::unbindInstanceAttributes() const
+{
+    for (GLuint location = InstanceData::ModelLocation; location <= InstanceData::TexCoordScaleLocation; location++)
+        glDisableVertexAttribArray(location);
+}
+
+void Mesh::draw(Shader& shader)
+{
+    _material.apply(shader);
+
+    // draw mesh with whatever instance values were set through InstanceData::setGeneric()
     glBindVertexArray(_VAO);
-    glDrawElements(GL_TRIANGLES, _indices.size(), GL_UNSIGNED_INT, 0);
+    applyVertexDecode();
+    unbindInstanceAttributes();
+    drawElements();
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
@@ -2,7 +2,12 @@
 #define MESH_H
 
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 #include "Shader.hpp"
+#include "Material.hpp"
+#include "Bounds.hpp"
 #include "glm/glm.hpp"
 
 struct Vertex {
@@ -13,6 +18,59 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+/**
+ * Compressed vertex, 20 bytes instead of the 56 of Vertex. The position is quantized
+ * to 16 bits within the mesh bounds, normal and tangent are octahedral-encoded and the
+ * texture coordinates are half floats. The bitangent is rebuilt in the vertex shader
+ * from the normal, the tangent and the handedness stored in position[3].
+ */
+struct PackedVertex {
+    uint16_t position[4];       // unorm within the mesh bounds; w: 0 for a flipped bitangent, else 65535
+    int16_t normal[2];          // snorm octahedral
+    int16_t tangent[2];
+    uint16_t texCoords[2];      // half floats
+
+    static PackedVertex pack(const Vertex& v, const glm::vec3& offset, const glm::vec3& scale);
+};
+
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+/* Layout of the vertex buffers created by Mesh */
+enum class VertexFormat {
+    Full,       // Vertex
+    Packed      // PackedVertex
+};
+
+/**
+ * Per-instance attributes consumed by Entity/shader.vert (locations 5-12). Uploaded
+ * into a shared instance buffer by the render queue, or set as constant generic
+ * attributes for single, non-instanced draws.
+ */
+struct InstanceData {
+    glm::mat4 model;
+    glm::vec3 invTransposeModel[3];     // columns of the 3x3 inverse-transpose
+    float texCoordScale;
+
+    enum Location : GLuint {
+        ModelLocation = 5,
+        InvTransposeModelLocation = 9,
+        TexCoordScaleLocation = 12
+    };
+
+    /* Set as constant attribute values, used while the instance arrays are disabled */
+    void setGeneric() const;
+};
+
+/**
+ * One level of detail: a range of the mesh's index buffer drawing a simplified version
+ * of the mesh with the same vertices. Level 0 is the full mesh.
+ */
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t numIndices;
+    float error;            // how far the surface moved from the full mesh, in object space
+};
+
 struct Texture {
     unsigned int id;
     std::string type;
@@ -21,20 +79,139 @@ struct Texture {
 
 class Mesh {
     public:
+        // constant per-mesh attributes, see applyVertexDecode()
+        enum DecodeLocation : GLuint {
+            PositionOffsetLocation = 13,
+            PositionScaleLocation = 14     // w: 1 for PackedVertex, 0 for Vertex
+        };
+
         Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
         Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess);
+
+        /**
+         * @brief Construct a mesh directly from vertex/index arrays owned by the caller
+         * (e.g. a memory-mapped mesh cache). The data is uploaded to the GPU and not retained.
+         *
+         * @param lods Index ranges of the levels of detail, finest first. Without any,
+         * all indices form the only level.
+         */
+        Mesh(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices,
+             std::vector<Texture> textures, glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess,
+             const MeshLod* lods = nullptr, size_t numLods = 0);
         void draw(Shader &shader);
-    
+
+        /* Layout of the vertex buffers of meshes created from now on (Full by default) */
+        static void setVertexFormat(VertexFormat format);
+        static VertexFormat vertexFormat();
+
+        /**
+         * @brief Set the constant attributes that tell the vertex shaders how to decode
+         * this mesh's vertices. Generic attribute values are not VAO state, so this is
+         * needed whenever this mesh's VAO is bound for drawing.
+         */
+        void applyVertexDecode() const;
+
+        /* Bytes of GPU memory taken by the vertex buffer */
+        size_t vertexBytes() const {
+            return _vertexBytes;
+        }
+
+        /* Bytes of GPU memory taken by the index buffer; 16-bit indices below 65536 vertices */
+        size_t indexBytes() const {
+            return _numIndices * (_indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t));
+        }
+
+        /* Issue the draw call only; material and VAO state are managed by the caller */
+        void drawElements(size_t lod = 0) const {
+            glDrawElements(GL_TRIANGLES, _lods[lod].numIndices, _indexType, indexOffset(lod));
+        }
+
+        void drawElementsInstanced(GLsizei instanceCount, size_t lod = 0) const {
+            glDrawElementsInstanced(GL_TRIANGLES, _lods[lod].numIndices, _indexType, indexOffset(lod), instanceCount);
+        }
+
+        size_t lodCount() const {
+            return _lods.size();
+        }
+
+        const MeshLod& lod(size_t level) const {
+            return _lods[level];
+        }
+
+        /**
+         * @brief Coarsest level whose error is at most one once multiplied by lodScale,
+         * e.g. the allowed screen-space error in pixels per object-space unit.
+         */
+        size_t selectLod(float lodScale) const {
+            for (size_t level = _lods.size() - 1; level > 0; level--) {
+                if (_lods[level].error * lodScale <= 1.0f)
+                    return level;
+            }
+            return 0;
+        }
+
+        /**
+         * @brief Source the per-instance attributes from buffer, starting at byte offset.
+         * This mesh's VAO must be bound.
+         */
+        void bindInstanceAttributes(GLuint buffer, size_t offset) const;
+
+        /* Fall back to the constant generic attribute values. This mesh's VAO must be bound. */
+        void unbindInstanceAttributes() const;
+
+        const Material& material() const {
+            return _material;
+        }
+
+        uint32_t materialId() const {
+            return _materialId;
+        }
+
+        unsigned int vao() const {
+            return _VAO;
+        }
+
+        /* Object-space bounds, computed when the mesh is created */
+        const AABB& bounds() const {
+            return _bounds;
+        }
+
+        const BoundingSphere& boundingSphere() const {
+            return _sphere;
+        }
+
+        /**
+         * @brief Delete the GL buffers backing this mesh. Meshes are copied by value
+         * into their Model, so this is called explicitly by the owning Model.
+         */
+        void release();
+
     private:
         unsigned int _VAO, _VBO, _EBO;
-        std::vector<Vertex> _vertices;
-        std::vector<unsigned int> _indices;
-        std::vector<Texture> _textures;
-        glm::vec3 _diffuse, _specular;
-        float _shininess;
-        void setupMesh();
+        size_t _numIndices = 0;
+        size_t _vertexBytes = 0;
+        GLenum _indexType = GL_UNSIGNED_INT;
+        std::vector<MeshLod> _lods;
+        bool _packed = false;
+        glm::vec3 _positionOffset = glm::vec3(0.0f);    // object position = offset + scale * attribute
+        glm::vec3 _positionScale = glm::vec3(1.0f);
+        Material _material;
+        uint32_t _materialId;
+        AABB _bounds;
+        BoundingSphere _sphere;
+        void setupMesh(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices);
+        void setupLods(size_t numIndices, const MeshLod* lods, size_t numLods);
+
+        const void* indexOffset(size_t lod) const {
+            size_t indexSize = _indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+            return (const void*)(_lods[lod].firstIndex * indexSize);
+        }
+        void setupFullAttributes();
+        void setupPackedAttributes();
+        void computeBounds(const Vertex* vertices, size_t numVertices);
+        void setupMaterial(const std::vector<Texture>& textures, glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess);
 
 
 };
 
-#endif // MESH_H
\ No newline at end of file
+#endif // MESH_H
@@ -0,0 +1,287 @@
+#include "MeshCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * File layout (all offsets 4-byte aligned, native endianness):
+ *
+ *  FileHeader
+ *  source path (pathLength bytes)
+ *  for each mesh:
+ *      MeshHeader
+ *      for each texture: uint32 typeLength, uint32 pathLength, type bytes, path bytes
+ *      MeshLod[numLods]
+ *      Vertex[numVertices]
+ *      uint32[numIndices]
+ */
+namespace {
+
+    const char kMagic[4] = { 'G', 'L', 'W', 'M' };
+    const uint32_t kVersion = 3;        // 2: meshes optimized by MeshOptimizer, 3: levels of detail
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t importFlags;
+        uint32_t vertexSize;
+        int64_t sourceMTime;
+        uint64_t sourceSize;
+        uint32_t pathLength;
+        uint32_t numMeshes;
+        float centroid[3];
+        uint32_t reserved;
+    };
+
+    struct MeshHeader {
+        uint32_t numVertices;
+        uint32_t numIndices;
+        uint32_t numTextures;
+        uint32_t numLods;
+        float diffuse[3];
+        float specular[3];
+        float shininess;
+    };
+
+    size_t align4(size_t offset) {
+        return (offset + 3) & ~size_t(3);
+    }
+
+    void writePadding(std::ofstream& out, size_t& offset) {
+        static const char zeros[4] = { 0, 0, 0, 0 };
+        size_t aligned = align4(offset);
+        out.write(zeros, aligned - offset);
+        offset = aligned;
+    }
+
+    void writeBytes(std::ofstream& out, size_t& offset, const void* data, size_t size) {
+        out.write(reinterpret_cast<const char*>(data), size);
+        offset += size;
+    }
+
+    // bounds-checked cursor over the mapped file
+    struct Reader {
+        const unsigned char* base;
+        size_t size;
+        size_t offset = 0;
+
+        const void* take(size_t n) {
+            if (offset + n > size)
+                return nullptr;
+            const void* p = base + offset;
+            offset += n;
+            return p;
+        }
+
+        void align() {
+            offset = align4(offset);
+        }
+    };
+}
+
+MeshCache::MeshCache(const std::string& sourcePath, unsigned int importFlags)
+    : _sourcePath(sourcePath), _cachePath(sourcePath + ".meshcache"), _importFlags(importFlags)
+{
+}
+
+MeshCache::~MeshCache()
+{
+    unmap();
+}
+
+bool MeshCache::sourceStamp(int64_t& mtime, uint64_t& size) const
+{
+    struct stat st;
+    if (stat(_sourcePath.c_str(), &st) != 0)
+        return false;
+
+    mtime = static_cast<int64_t>(st.st_mtime);
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+void MeshCache::unmap()
+{
+    if (_mapped) {
+        munmap(_mapped, _mappedSize);
+        _mapped = nullptr;
+        _mappedSize = 0;
+    }
+    _meshes.clear();
+}
+
+bool MeshCache::load()
+{
+    unmap();
+
+    int64_t mtime;
+    uint64_t sourceSize;
+    if (!sourceStamp(mtime, sourceSize))
+        return false;
+
+    int fd = open(_cachePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+        close(fd);
+        return false;
+    }
+
+    _mappedSize = static_cast<size_t>(st.st_size);
+    _mapped = mmap(nullptr, _mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (_mapped == MAP_FAILED) {
+        _mapped = nullptr;
+        _mappedSize = 0;
+        return false;
+    }
+
+    Reader reader { static_cast<const unsigned char*>(_mapped), _mappedSize };
+    const FileHeader* header = static_cast<const FileHeader*>(reader.take(sizeof(FileHeader)));
+
+    bool valid = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0
+        && header->version == kVersion
+        && header->importFlags == _importFlags
+        && header->vertexSize == sizeof(Vertex)
+        && header->sourceMTime == mtime
+        && header->sourceSize == sourceSize;
+
+    const char* path = valid ? static_cast<const char*>(reader.take(header->pathLength)) : nullptr;
+    if (!path || std::string(path, header->pathLength) != _sourcePath) {
+        unmap();
+        return false;
+    }
+
+    for (uint32_t m = 0; m < header->numMeshes; m++) {
+        reader.align();
+        const MeshHeader* mh = static_cast<const MeshHeader*>(reader.take(sizeof(MeshHeader)));
+        if (!mh) {
+            unmap();
+            return false;
+        }
+
+        CachedMesh mesh;
+        mesh.numVertices = mh->numVertices;
+        mesh.numIndices = mh->numIndices;
+        mesh.diffuse = glm::vec3(mh->diffuse[0], mh->diffuse[1], mh->diffuse[2]);
+        mesh.specular = glm::vec3(mh->specular[0], mh->specular[1], mh->specular[2]);
+        mesh.shininess = mh->shininess;
+
+        for (uint32_t t = 0; t < mh->numTextures; t++) {
+            reader.align();
+            const uint32_t* lengths = static_cast<const uint32_t*>(reader.take(2 * sizeof(uint32_t)));
+            const char* type = lengths ? static_cast<const char*>(reader.take(lengths[0])) : nullptr;
+            const char* texPath = type ? static_cast<const char*>(reader.take(lengths[1])) : nullptr;
+            if (!texPath) {
+                unmap();
+                return false;
+            }
+
+            Texture texture;
+            texture.id = 0;
+            texture.type = std::string(type, lengths[0]);
+            texture.path = std::string(texPath, lengths[1]);
+            mesh.textures.push_back(texture);
+        }
+
+        reader.align();
+        mesh.numLods = mh->numLods;
+        mesh.lods = static_cast<const MeshLod*>(reader.take(sizeof(MeshLod) * mesh.numLods));
+        mesh.vertices = static_cast<const Vertex*>(reader.take(sizeof(Vertex) * mesh.numVertices));
+        mesh.indices = static_cast<const unsigned int*>(reader.take(sizeof(unsigned int) * mesh.numIndices));
+        if (!mesh.lods || !mesh.vertices || !mesh.indices) {
+            unmap();
+            return false;
+        }
+
+        _meshes.push_back(mesh);
+    }
+
+    _centroid = glm::vec3(header->centroid[0], header->centroid[1], header->centroid[2]);
+    return true;
+}
+
+bool MeshCache::write(const std::vector<MeshData>& meshes, const glm::vec3& centroid) const
+{
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.importFlags = _importFlags;
+    header.vertexSize = sizeof(Vertex);
+    header.pathLength = static_cast<uint32_t>(_sourcePath.size());
+    header.numMeshes = static_cast<uint32_t>(meshes.size());
+    header.centroid[0] = centroid.x;
+    header.centroid[1] = centroid.y;
+    header.centroid[2] = centroid.z;
+    header.reserved = 0;
+    if (!sourceStamp(header.sourceMTime, header.sourceSize))
+        return false;
+
+    // write to a temporary file first so a crash never leaves a truncated cache behind
+    std::string tmpPath = _cachePath + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "MESHCACHE::ERROR: Could not open " << tmpPath << " for writing" << std::endl;
+        return false;
+    }
+
+    size_t offset = 0;
+    writeBytes(out, offset, &header, sizeof(header));
+    writeBytes(out, offset, _sourcePath.data(), _sourcePath.size());
+
+    for (const auto& mesh : meshes) {
+        MeshHeader mh;
+        mh.numVertices = static_cast<uint32_t>(mesh.vertices.size());
+        mh.numIndices = static_cast<uint32_t>(mesh.indices.size());
+        mh.numTextures = static_cast<uint32_t>(mesh.textures.size());
+        mh.numLods = static_cast<uint32_t>(mesh.lods.size());
+        for (int i = 0; i < 3; i++) {
+            mh.diffuse[i] = mesh.diffuse[i];
+            mh.specular[i] = mesh.specular[i];
+        }
+        mh.shininess = mesh.shininess;
+
+        writePadding(out, offset);
+        writeBytes(out, offset, &mh, sizeof(mh));
+
+        for (const auto& texture : mesh.textures) {
+            uint32_t lengths[2] = { static_cast<uint32_t>(texture.type.size()), static_cast<uint32_t>(texture.path.size()) };
+            writePadding(out, offset);
+            writeBytes(out, offset, lengths, sizeof(lengths));
+            writeBytes(out, offset, texture.type.data(), texture.type.size());
+            writeBytes(out, offset, texture.path.data(), texture.path.size());
+        }
+
+        writePadding(out, offset);
+        writeBytes(out, offset, mesh.lods.data(), sizeof(MeshLod) * mesh.lods.size());
+        writeBytes(out, offset, mesh.vertices.data(), sizeof(Vertex) * mesh.vertices.size());
+        writeBytes(out, offset, mesh.indices.data(), sizeof(unsigned int) * mesh.indices.size());
+    }
+
+    out.close();
+    if (!out) {
+        std::cout << "MESHCACHE::ERROR: Failed to write " << tmpPath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, _cachePath, ec);
+    if (ec) {
+        std::cout << "MESHCACHE::ERROR: Could not replace " << _cachePath << ": " << ec.message() << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
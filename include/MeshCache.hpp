@@ -0,0 +1,100 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "Mesh.hpp"
+
+/**
+ * CPU-side copy of a mesh as produced by the assimp import: flattened vertex/index
+ * arrays plus the material information needed to rebuild the Mesh.
+ */
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;  // every level of detail, finest first
+    std::vector<MeshLod> lods;          // empty: the indices form the only level
+    std::vector<Texture> textures;      // only type and path are meaningful here
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    glm::vec3 specular = glm::vec3(0.0f);
+    float shininess = 0.0f;
+};
+
+/**
+ * View into a mesh stored in a memory-mapped cache file. Vertex and index
+ * pointers stay valid for as long as the owning MeshCache is alive.
+ */
+struct CachedMesh {
+    const Vertex* vertices;
+    uint32_t numVertices;
+    const unsigned int* indices;
+    uint32_t numIndices;
+    const MeshLod* lods;
+    uint32_t numLods;
+    std::vector<Texture> textures;      // only type and path are meaningful here
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float shininess;
+};
+
+/**
+ * On-disk cache of imported models. A cache file lives next to its source
+ * (<source>.meshcache) and is keyed by the source path, its modification time and
+ * size, and the assimp import flags. Any mismatch, or a bump of the format
+ * version, makes the cache stale and the model is re-imported.
+ */
+class MeshCache
+{
+    public:
+        MeshCache(const std::string& sourcePath, unsigned int importFlags);
+        ~MeshCache();
+
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+
+        /**
+         * @brief Memory-map the cache file and validate it against the source.
+         *
+         * @return true if the cache exists and is up to date.
+         */
+        bool load();
+
+        /**
+         * @brief Serialize imported meshes to the cache file, replacing any stale copy.
+         *
+         * @return true on success.
+         */
+        bool write(const std::vector<MeshData>& meshes, const glm::vec3& centroid) const;
+
+        const std::vector<CachedMesh>& meshes() const {
+            return _meshes;
+        }
+
+        glm::vec3 centroid() const {
+            return _centroid;
+        }
+
+        std::string cachePath() const {
+            return _cachePath;
+        }
+
+    private:
+        bool sourceStamp(int64_t& mtime, uint64_t& size) const;
+        void unmap();
+
+    private:
+        std::string _sourcePath;
+        std::string _cachePath;
+        unsigned int _importFlags;
+
+        void* _mapped = nullptr;
+        size_t _mappedSize = 0;
+
+        std::vector<CachedMesh> _meshes;
+        glm::vec3 _centroid = glm::vec3(0.0f);
+};
+
+#endif // MESH_CACHE_H
@@ -0,0 +1,498 @@
+#include "MeshOptimizer.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+    // Forsyth's scoring; the cache is only modelled, its size need not match the GPU's
+    const int kScoreCacheSize = 32;
+    const float kCacheDecayPower = 1.5f;
+    const float kLastTriScore = 0.75f;
+    const float kValenceBoostScale = 2.0f;
+    const float kValenceBoostPower = 0.5f;
+
+    float vertexScore(int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            // the vertices of the last triangle get a fixed score, so it is not immediately reused
+            if (cachePosition < 3)
+                score = kLastTriScore;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / float(kScoreCacheSize - 3), kCacheDecayPower);
+        }
+
+        // prefer vertices with few triangles left, so they drop out of the mesh early
+        score += kValenceBoostScale * std::pow(float(remainingTriangles), -kValenceBoostPower);
+        return score;
+    }
+
+    struct VertexHash {
+        size_t operator()(const Vertex& v) const {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+            size_t h = 14695981039346656037ull;
+            for (size_t i = 0; i < sizeof(Vertex); i++)
+                h = (h ^ bytes[i]) * 1099511628211ull;
+            return h;
+        }
+    };
+
+    struct VertexEqual {
+        bool operator()(const Vertex& a, const Vertex& b) const {
+            return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    struct PositionHash {
+        size_t operator()(const glm::vec3& p) const {
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (size_t(bits[0]) * 73856093u) ^ (size_t(bits[1]) * 19349663u) ^ (size_t(bits[2]) * 83492791u);
+        }
+    };
+
+    /* Sum of squared distances to a set of planes, as a symmetric 4x4 matrix */
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+
+        void addPlane(double nx, double ny, double nz, double d) {
+            a00 += nx * nx; a01 += nx * ny; a02 += nx * nz; a03 += nx * d;
+            a11 += ny * ny; a12 += ny * nz; a13 += ny * d;
+            a22 += nz * nz; a23 += nz * d;
+            a33 += d * d;
+        }
+
+        void add(const Quadric& q) {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+        }
+
+        double error(const glm::vec3& p) const {
+            double x = p.x, y = p.y, z = p.z;
+            double e = x * x * a00 + y * y * a11 + z * z * a22 + a33
+                     + 2.0 * (x * y * a01 + x * z * a02 + y * z * a12 + x * a03 + y * a13 + z * a23);
+            return std::max(e, 0.0);
+        }
+    };
+
+    uint64_t edgeKey(unsigned int a, unsigned int b) {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+}
+
+namespace meshopt {
+
+float acmr(const std::vector<unsigned int>& indices, size_t numVertices, size_t cacheSize)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+        return 0.0f;
+
+    // FIFO cache: a vertex is in the cache if it was transformed within the last cacheSize misses
+    std::vector<size_t> missTime(numVertices, 0);
+    size_t misses = 0;
+    for (unsigned int index : indices) {
+        if (missTime[index] == 0 || misses - missTime[index] >= cacheSize)
+            missTime[index] = ++misses;
+    }
+    return float(misses) / float(numTriangles);
+}
+
+void weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto inserted = unique.emplace(vertices[i], static_cast<unsigned int>(welded.size()));
+        if (inserted.second)
+            welded.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+
+    for (unsigned int& index : indices)
+        index = remap[index];
+    vertices.swap(welded);
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t numVertices)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles == 0 || indices.size() % 3 != 0)
+        return;
+
+    // triangles using each vertex, packed into one array; shrinks as triangles are emitted
+    std::vector<unsigned int> remaining(numVertices, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+
+    std::vector<unsigned int> offsets(numVertices + 1, 0);
+    for (size_t v = 0; v < numVertices; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < numTriangles; t++) {
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[indices[3 * t + k]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cachePosition(numVertices, -1);
+    std::vector<float> score(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+        score[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(numTriangles);
+    std::vector<bool> emitted(numTriangles, false);
+    for (size_t t = 0; t < numTriangles; t++)
+        triangleScore[t] = score[indices[3 * t]] + score[indices[3 * t + 1]] + score[indices[3 * t + 2]];
+
+    std::vector<unsigned int> cache, newCache;
+    cache.reserve(kScoreCacheSize + 3);
+    newCache.reserve(kScoreCacheSize + 3);
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    size_t best = std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin();
+    size_t scan = 0;       // every triangle before it has been emitted
+
+    for (size_t emittedCount = 0; emittedCount < numTriangles; emittedCount++) {
+        if (best == SIZE_MAX) {
+            // nothing in the cache touches a remaining triangle: continue with the next one
+            while (emitted[scan])
+                scan++;
+            best = scan;
+        }
+
+        const unsigned int* tri = &indices[3 * best];
+        result.insert(result.end(), tri, tri + 3);
+        emitted[best] = true;
+
+        // the triangle's vertices move to the front of the cache
+        newCache.assign(tri, tri + 3);
+        for (unsigned int v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                newCache.push_back(v);
+        }
+
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = tri[k];
+            unsigned int* begin = &adjacency[offsets[v]];
+            unsigned int* end = begin + remaining[v];
+            *std::find(begin, end, static_cast<unsigned int>(best)) = *(end - 1);
+            remaining[v]--;
+        }
+
+        // rescore every vertex whose cache position changed, and the triangles using them
+        for (size_t i = 0; i < newCache.size(); i++) {
+            unsigned int v = newCache[i];
+            cachePosition[v] = i < size_t(kScoreCacheSize) ? int(i) : -1;
+            float newScore = vertexScore(cachePosition[v], remaining[v]);
+            float delta = newScore - score[v];
+            score[v] = newScore;
+
+            for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+                triangleScore[adjacency[a]] += delta;
+        }
+
+        if (newCache.size() > size_t(kScoreCacheSize))
+            newCache.resize(kScoreCacheSize);
+        cache.swap(newCache);
+
+        // the next triangle is the best one touching the cache
+        best = SIZE_MAX;
+        float bestScore = -1.0f;
+        for (unsigned int v : cache) {
+            for (unsigned int a = offsets[v]; a < offsets[v] + remaining[v]; a++) {
+                unsigned int t = adjacency[a];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+    size_t numTriangles = indices.size() / 3;
+    if (numTriangles < 2 || indices.size() % 3 != 0)
+        return;
+
+    float before = acmr(indices, vertices.size());
+
+    // clusters start at triangles whose vertices all miss the cache
+    std::vector<size_t> clusterStart;
+    std::vector<size_t> missTime(vertices.size(), 0);
+    size_t misses = 0;
+    for (size_t t = 0; t < numTriangles; t++) {
+        int triangleMisses = 0;
+        for (int k = 0; k < 3; k++) {
+            unsigned int index = indices[3 * t + k];
+            if (missTime[index] == 0 || misses - missTime[index] >= ReportCacheSize) {
+                missTime[index] = ++misses;
+                triangleMisses++;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+            clusterStart.push_back(t);
+    }
+    clusterStart.push_back(numTriangles);
+
+    size_t numClusters = clusterStart.size() - 1;
+    if (numClusters < 2)
+        return;
+
+    // area weighted centroid and normal of every cluster, and of the whole mesh
+    std::vector<glm::vec3> clusterCentroid(numClusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormal(numClusters, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < numClusters; c++) {
+        float clusterArea = 0.0f;
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++) {
+            const glm::vec3& p0 = vertices[indices[3 * t]].Position;
+            const glm::vec3& p1 = vertices[indices[3 * t + 1]].Position;
+            const glm::vec3& p2 = vertices[indices[3 * t + 2]].Position;
+
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(n);
+            clusterCentroid[c] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormal[c] += n;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroid[c];
+        meshArea += clusterArea;
+        if (clusterArea > 0.0f)
+            clusterCentroid[c] /= clusterArea;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // clusters far out along their own normal occlude the rest from most directions
+    std::vector<float> sortKey(numClusters);
+    for (size_t c = 0; c < numClusters; c++) {
+        float length = glm::length(clusterNormal[c]);
+        glm::vec3 normal = length > 0.0f ? clusterNormal[c] / length : glm::vec3(0.0f);
+        sortKey[c] = glm::dot(clusterCentroid[c] - meshCentroid, normal);
+    }
+
+    std::vector<size_t> order(numClusters);
+    for (size_t c = 0; c < numClusters; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + 3 * clusterStart[c], indices.begin() + 3 * clusterStart[c + 1]);
+
+    if (acmr(result, vertices.size()) <= before * threshold)
+        indices.swap(result);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    const unsigned int unused = UINT32_MAX;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (unsigned int& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<unsigned int>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+std::vector<unsigned int> simplify(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                                   size_t targetIndexCount, float& error)
+{
+    error = 0.0f;
+    std::vector<unsigned int> result(indices);
+    if (indices.size() % 3 != 0)
+        return result;
+
+    const size_t numVertices = vertices.size();
+
+    // topology is decided on positions, so attribute seams do not look like borders
+    std::unordered_map<glm::vec3, unsigned int, PositionHash> positionIds;
+    std::vector<unsigned int> positionId(numVertices);
+    std::vector<unsigned int> positionUses;
+    for (size_t v = 0; v < numVertices; v++) {
+        auto inserted = positionIds.emplace(vertices[v].Position, static_cast<unsigned int>(positionUses.size()));
+        if (inserted.second)
+            positionUses.push_back(0);
+        positionId[v] = inserted.first->second;
+        positionUses[positionId[v]]++;
+    }
+
+    std::unordered_map<uint64_t, unsigned int> edgeUses;
+    for (size_t i = 0; i < result.size(); i += 3) {
+        for (int k = 0; k < 3; k++)
+            edgeUses[edgeKey(positionId[result[i + k]], positionId[result[i + (k + 1) % 3]])]++;
+    }
+
+    // positions on open borders or non-manifold edges stay where they are
+    std::vector<bool> lockedPosition(positionUses.size(), false);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            unsigned int a = positionId[result[i + k]], b = positionId[result[i + (k + 1) % 3]];
+            if (edgeUses[edgeKey(a, b)] != 2)
+                lockedPosition[a] = lockedPosition[b] = true;
+        }
+    }
+
+    std::vector<bool> locked(numVertices);
+    for (size_t v = 0; v < numVertices; v++)
+        locked[v] = lockedPosition[positionId[v]] || positionUses[positionId[v]] > 1;
+
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const glm::vec3& p0 = vertices[result[i]].Position;
+        glm::vec3 n = glm::cross(vertices[result[i + 1]].Position - p0, vertices[result[i + 2]].Position - p0);
+        float length = glm::length(n);
+        if (length == 0.0f)
+            continue;
+
+        n /= length;
+        Quadric q;
+        q.addPlane(n.x, n.y, n.z, -glm::dot(n, p0));
+        for (int k = 0; k < 3; k++)
+            quadrics[result[i + k]].add(q);
+    }
+
+    struct Collapse {
+        unsigned int from, to;
+        double cost;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<unsigned int> offsets, adjacency, remap(numVertices);
+    std::vector<bool> touched;
+
+    while (result.size() > targetIndexCount) {
+        size_t numTriangles = result.size() / 3;
+
+        offsets.assign(numVertices + 1, 0);
+        for (unsigned int index : result)
+            offsets[index + 1]++;
+        for (size_t v = 0; v < numVertices; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(result.size());
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t t = 0; t < numTriangles; t++) {
+            for (int k = 0; k < 3; k++)
+                adjacency[fill[result[3 * t + k]]++] = static_cast<unsigned int>(t);
+        }
+
+        // moving a vertex onto a neighbour keeps the neighbour's attributes
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int k = 0; k < 3; k++) {
+                unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                if (!locked[a]) {
+                    Quadric q = quadrics[a];
+                    q.add(quadrics[b]);
+                    collapses.push_back({ a, b, q.error(vertices[b].Position) });
+                }
+                if (!locked[b]) {
+                    Quadric q = quadrics[b];
+                    q.add(quadrics[a]);
+                    collapses.push_back({ b, a, q.error(vertices[a].Position) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+        // collapse the cheapest edges whose one-rings do not overlap, so each flip test stays valid
+        for (size_t v = 0; v < numVertices; v++)
+            remap[v] = static_cast<unsigned int>(v);
+        touched.assign(numVertices, false);
+
+        size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        size_t removed = 0;
+        for (const Collapse& c : collapses) {
+            if (removed >= trianglesToRemove)
+                break;
+            if (touched[c.from] || touched[c.to])
+                continue;
+
+            bool flips = false;
+            size_t lost = 0;
+            const glm::vec3& target = vertices[c.to].Position;
+            for (unsigned int a = offsets[c.from]; a < offsets[c.from + 1] && !flips; a++) {
+                const unsigned int* tri = &result[3 * adjacency[a]];
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+                    lost++;
+                    continue;
+                }
+
+                glm::vec3 p[3], q[3];
+                for (int k = 0; k < 3; k++) {
+                    p[k] = vertices[tri[k]].Position;
+                    q[k] = tri[k] == c.from ? target : p[k];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                // also reject triangles tilting by more than about 75 degrees, slivers flip easily later
+                flips = glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after);
+            }
+            if (flips)
+                continue;
+
+            for (unsigned int a = offsets[c.from]; a < offsets[c.from + 1]; a++) {
+                const unsigned int* tri = &result[3 * adjacency[a]];
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+            }
+
+            remap[c.from] = c.to;
+            quadrics[c.to].add(quadrics[c.from]);
+            error = std::max(error, float(std::sqrt(c.cost)));
+            removed += lost;
+        }
+
+        if (removed == 0)
+            break;
+
+        std::vector<unsigned int> simplified;
+        simplified.reserve(result.size());
+        for (size_t i = 0; i < result.size(); i += 3) {
+            unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a != b && b != c && a != c) {
+                simplified.push_back(a);
+                simplified.push_back(b);
+                simplified.push_back(c);
+            }
+        }
+        result.swap(simplified);
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstddef>
+
+#include "Mesh.hpp"
+
+/**
+ * Import-time optimizations of indexed triangle lists. Run once by Model::import, the
+ * results are stored in the mesh cache, so none of this costs anything on a warm start.
+ */
+namespace meshopt {
+
+    /* Entries of the FIFO post-transform cache ACMR is measured against */
+    const size_t ReportCacheSize = 16;
+
+    /**
+     * @brief Average cache miss ratio: vertex shader invocations per triangle with a
+     * FIFO post-transform cache of cacheSize entries. 0.5 is the ideal for large
+     * regular meshes, 3 means no vertex is ever reused.
+     */
+    float acmr(const std::vector<unsigned int>& indices, size_t numVertices, size_t cacheSize = ReportCacheSize);
+
+    /* Merge bitwise identical vertices and remap indices onto them */
+    void weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     * @brief Reorder triangles so vertices are reused while still in the post-transform
+     * cache (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+     */
+    void optimizeVertexCache(std::vector<unsigned int>& indices, size_t numVertices);
+
+    /**
+     * @brief Reorder clusters of triangles so outward facing ones are drawn first and
+     * hide what lies behind them (Sander et al., "Fast Triangle Reordering for Vertex
+     * Locality and Reduced Overdraw"). Clusters start where the cache runs cold, so the
+     * cache locality of optimizeVertexCache() is mostly kept; the new order is dropped
+     * if it raises the ACMR by more than threshold.
+     */
+    void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+    /* Renumber vertices in the order the indices first use them, dropping unused ones */
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     * @brief Simplify a triangle list by collapsing edges in order of quadric error
+     * (Garland and Heckbert) until at most targetIndexCount indices remain or no edge
+     * can be collapsed. Vertices keep their positions and attributes, so the result
+     * indexes the same vertex array. Open borders and attribute seams (vertices sharing a
+     * position with different normals or texture coordinates) are never moved, and
+     * collapses that would flip a triangle are skipped.
+     *
+     * @return the simplified indices; error is set to the largest distance a collapse
+     * moved the surface, in object space.
+     */
+    std::vector<unsigned int> simplify(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                                       size_t targetIndexCount, float& error);
+
+}
+
+#endif // MESH_OPTIMIZER_H
@@ -1,7 +1,16 @@
 #include "Model.hpp"
+#include "Profiler.hpp"
+#include "MeshOptimizer.hpp"
 
-//#define STB_IMAGE_IMPLEMENTATION
-#include "stb/stb_image.h"
+#include <sstream>
+
+
+Model::~Model()
+{
+    for (auto& mesh : _meshes) {
+        mesh.release();
+    }
+}
 
 void Model::draw(Shader& shader)
 {
@@ -10,39 +19,120 @@ void Model::draw(Shader& shader)
     }
 }
 
-void Model::loadModel(const std::string path)
+Model::Model(ModelData data)
+    : _data(std::move(data))
 {
+    _directory = _data.path.substr(0, _data.path.find_last_of('/'));
+    _centroid = _data.centroid;
+    _numImportedMeshes = _data.numMeshes();
+    _meshes.reserve(_numImportedMeshes);
+}
+
+ModelData Model::import(const std::string& path)
+{
+    PROFILE_ZONE("model import");
+    const unsigned int importFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+    ModelData data;
+    data.path = path;
+
+    // warm start: upload straight from the memory-mapped cache, skipping assimp
+    auto cache = std::make_unique<MeshCache>(path, importFlags);
+    if (cache->load()) {
+        data.centroid = cache->centroid();
+        data.cache = std::move(cache);
+        data.valid = true;
+        return data;
+    }
+
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    const aiScene* scene = importer.ReadFile(path, importFlags);
     
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        return data;
     }
 
-    _directory = path.substr(0, path.find_last_of('/'));
+    glm::vec3 centroidSum(0.0f);
+    processNode(scene->mRootNode, scene, data.meshes, centroidSum);
 
-    processNode(scene->mRootNode, scene);
-        
-    _centroid /= _numVertices;      // both values computed in processNode()
+    size_t numVertices = 0;
+    for (const auto& mesh : data.meshes)
+        numVertices += mesh.vertices.size();
+    if (numVertices > 0)
+        data.centroid = centroidSum / float(numVertices);
+    data.valid = true;
+
+    if (!cache->write(data.meshes, data.centroid)) {
+        std::cout << "MODEL::WARNING: Could not write mesh cache for " << path << std::endl;
+    }
+    return data;
+}
+
+bool Model::uploadNextMesh()
+{
+    if (uploaded())
+        return true;
+
+    PROFILE_ZONE("mesh upload");
+    size_t i = _meshes.size();
+    if (_data.cache) {
+        const CachedMesh& cached = _data.cache->meshes()[i];
+        _meshes.emplace_back(cached.vertices, cached.numVertices, cached.indices, cached.numIndices,
+                             loadTextures(cached.textures), cached.diffuse, cached.specular, cached.shininess,
+                             cached.lods, cached.numLods);
+    } else {
+        const MeshData& data = _data.meshes[i];
+        _meshes.emplace_back(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size(),
+                             loadTextures(data.textures), data.diffuse, data.specular, data.shininess,
+                             data.lods.data(), data.lods.size());
+    }
+
+    if (!uploaded())
+        return false;
+
+    computeBounds();
+
+    // the GPU has its copy now; unmap the cache or free the imported arrays
+    _data = ModelData();
+    return true;
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::computeBounds()
+{
+    for (const auto& mesh : _meshes)
+        _bounds.expand(mesh.bounds());
+
+    if (_bounds.empty())
+        return;
+
+    _sphere.center = _bounds.center();
+    _sphere.radius = 0.0f;
+    for (const auto& mesh : _meshes) {
+        const BoundingSphere& s = mesh.boundingSphere();
+        if (!s.empty())
+            _sphere.radius = std::max(_sphere.radius, glm::length(s.center - _sphere.center) + s.radius);
+    }
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes, glm::vec3& centroidSum)
 {
     for (int i = 0; i < node->mNumMeshes; i++) {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        _meshes.push_back(processMesh(mesh, scene));
+        meshes.push_back(processMesh(mesh, scene, centroidSum));
     }
 
     for (int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, meshes, centroidSum);
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+MeshData Model::processMesh(aiMesh* mesh, const aiScene* scene, glm::vec3& centroidSum)
 {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    MeshData data;
+    std::vector<Vertex>& vertices = data.vertices;
+    std::vector<unsigned int>& indices = data.indices;
+    std::vector<Texture>& textures = data.textures;
 
     // process vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
@@ -55,7 +145,7 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         vertex.Position = vector;
 
         // update centroid
-        _centroid += vector;
+        centroidSum += vector;
 
         vector.x = mesh->mNormals[i].x;
         vector.y = mesh->mNormals[i].y;
@@ -99,6 +189,10 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         }
     }
 
+    // point and line faces would be mistaken for triangles
+    if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+        optimizeMesh(data, mesh->mName.C_Str());
+
     // process material
     glm::vec3 diffuseColor(0.0f), specularColor(0.0f);
     float shininess = 0.0f;
@@ -132,9 +226,67 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         material->Get(AI_MATKEY_SHININESS, shininess);
     }
 
-    Mesh m(vertices, indices, textures, diffuseColor, specularColor, shininess);
-    _numVertices += vertices.size();
-    return m;
+    data.diffuse = diffuseColor;
+    data.specular = specularColor;
+    data.shininess = shininess;
+    return data;
+}
+
+/**
+ * @brief Weld the vertices assimp duplicated per face, then reorder triangles for the
+ * post-transform cache and for overdraw and vertices for fetch locality.
+ */
+void Model::optimizeMesh(MeshData& data, const std::string& name)
+{
+    size_t importedVertices = data.vertices.size();
+    float acmrBefore = meshopt::acmr(data.indices, data.vertices.size());
+
+    meshopt::weldVertices(data.vertices, data.indices);
+    meshopt::optimizeVertexCache(data.indices, data.vertices.size());
+    meshopt::optimizeOverdraw(data.indices, data.vertices);
+    meshopt::optimizeVertexFetch(data.vertices, data.indices);
+
+    // one write, so lines of concurrent imports do not interleave
+    std::ostringstream report;
+    report << "MODEL::INFO: Mesh " << (name.empty() ? "<unnamed>" : name) << ": "
+           << importedVertices << " -> " << data.vertices.size() << " vertices, ACMR "
+           << acmrBefore << " -> " << meshopt::acmr(data.indices, data.vertices.size());
+
+    buildLods(data);
+    if (data.lods.size() > 1) {
+        report << ", LOD triangles";
+        for (const MeshLod& lod : data.lods)
+            report << " " << lod.numIndices / 3;
+    }
+    report << "\n";
+    std::cout << report.str() << std::flush;
+}
+
+/**
+ * @brief Append simplified copies of the mesh's indices, each with about half the
+ * triangles of the previous level, until simplification stops paying off.
+ */
+void Model::buildLods(MeshData& data)
+{
+    const size_t maxLods = 4;
+    const size_t minTriangles = 64;
+
+    data.lods.assign(1, { 0, static_cast<uint32_t>(data.indices.size()), 0.0f });
+    std::vector<unsigned int> previous = data.indices;
+    float error = 0.0f;
+
+    while (data.lods.size() < maxLods && previous.size() / 3 >= 2 * minTriangles) {
+        float levelError;
+        std::vector<unsigned int> level = meshopt::simplify(previous, data.vertices, previous.size() / 2, levelError);
+        if (level.size() > previous.size() * 4 / 5)
+            break;
+
+        meshopt::optimizeVertexCache(level, data.vertices.size());
+        error += levelError;        // each level is simplified from the previous one
+        data.lods.push_back({ static_cast<uint32_t>(data.indices.size()), static_cast<uint32_t>(level.size()), error });
+        data.indices.insert(data.indices.end(), level.begin(), level.end());
+        previous.swap(level);
+    }
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
@@ -145,7 +297,7 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
         aiString str;
         mat->GetTexture(type, i, &str);
         Texture texture;
-        texture.id = textureFromFile(str.C_Str(), _directory);
+        texture.id = 0;     // uploaded later by loadTextures()
         texture.type = typeName;
         texture.path = std::string(str.C_Str());
         textures.push_back(texture);
@@ -154,44 +306,23 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
     return textures;
 }
 
-unsigned int Model::textureFromFile(const char *path, const std::string &directory, bool gamma)
+std::vector<Texture> Model::loadTextures(std::vector<Texture> textures)
+{
+    for (auto& texture : textures) {
+        TextureKind kind = texture.type == "texture_normal" ? TextureKind::Normal : TextureKind::Color;
+        texture.id = textureFromFile(texture.path.c_str(), _directory, kind);
+    }
+
+    return textures;
+}
+
+unsigned int Model::textureFromFile(const char *path, const std::string &directory, TextureKind kind)
 {
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-        else
-            format = GL_RGB;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
\ No newline at end of file
+    // shared with every other model that references the same file
+    TextureHandle texture = ResourceManager::instance().acquireTexture(filename, kind);
+    _textures.push_back(texture);
+    return texture->id;
+}
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
@@ -11,15 +12,43 @@
 
 #include "Shader.hpp"
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "ResourceManager.hpp"
+
+/**
+ * CPU side of a model, read from the mesh cache or imported with assimp by
+ * Model::import(). Touches no GL state, so it can be produced on any thread.
+ */
+struct ModelData {
+    std::string path;
+    std::unique_ptr<MeshCache> cache;   // warm start, meshes are read from its mapping
+    std::vector<MeshData> meshes;       // cold start
+    glm::vec3 centroid = glm::vec3(0.0f);
+    bool valid = false;
+
+    size_t numMeshes() const {
+        return cache ? cache->meshes().size() : meshes.size();
+    }
+};
 
 class Model 
 {
     public:
         Model(const char *path)
+            : Model(import(path))
         {
-            loadModel(path);
+            while (!uploadNextMesh()) {}
         }
 
+        /* Take over imported data; the meshes are created by uploadNextMesh() */
+        explicit Model(ModelData data);
+
+        ~Model();
+
+        // owns GL buffers; share through ResourceManager::acquireModel instead of copying
+        Model(const Model&) = delete;
+        Model& operator=(const Model&) = delete;
+
         void setModelMat(const glm::mat4& m) {
             _model = m;
         }
@@ -28,24 +57,63 @@ class Model
             return _centroid;
         }
 
+        /* Object-space bounds enclosing every mesh */
+        const AABB& bounds() const {
+            return _bounds;
+        }
+
+        const BoundingSphere& boundingSphere() const {
+            return _sphere;
+        }
+
+        const std::vector<Mesh>& meshes() const {
+            return _meshes;
+        }
+
         void draw(Shader &shader);	
+
+        /**
+         * @brief Read a model from its mesh cache, or import it with assimp and write
+         * the cache. Safe to call from worker threads.
+         */
+        static ModelData import(const std::string& path);
+
+        /**
+         * @brief Upload the next imported mesh (and request its textures). Must run on
+         * the GL thread.
+         * @return true once every mesh is uploaded and the bounds are known.
+         */
+        bool uploadNextMesh();
+
+        bool uploaded() const {
+            return _meshes.size() == _numImportedMeshes;
+        }
+
     private:
         // model data
         std::vector<Mesh> _meshes;
+        std::vector<TextureHandle> _textures;  // keeps shared textures alive while meshes use them
         std::string _directory;
 
+        ModelData _data;        // released once every mesh is uploaded
+        size_t _numImportedMeshes;
+
         // helper functions for loading model via assimp
-        void loadModel(const std::string path);
-        void processNode(aiNode *node, const aiScene *scene);
-        Mesh processMesh(aiMesh *mesh, const aiScene *scene);
-        std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, 
+        void computeBounds();
+        static void processNode(aiNode *node, const aiScene *scene, std::vector<MeshData>& meshes, glm::vec3& centroidSum);
+        static MeshData processMesh(aiMesh *mesh, const aiScene *scene, glm::vec3& centroidSum);
+        static void optimizeMesh(MeshData& data, const std::string& name);
+        static void buildLods(MeshData& data);
+        static std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, 
                                              std::string typeName);
-        unsigned int textureFromFile(const char* path, const std::string& directory, bool gamma = false);
+        std::vector<Texture> loadTextures(std::vector<Texture> textures);
+        unsigned int textureFromFile(const char* path, const std::string& directory, TextureKind kind = TextureKind::Color);
 
         // transforms
         glm::mat4 _model;
-        glm::vec3 _centroid;    // compute on construction
-        int _numVertices = 0;
+        glm::vec3 _centroid = glm::vec3(0.0f);    // compute on construction
+        AABB _bounds;
+        BoundingSphere _sphere;
 };
 
 #endif // MODEL_H
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "Profiler.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+std::atomic<bool> Profiler::_enabled{false};
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::ThreadBuffer& Profiler::threadBuffer()
+{
+    // buffers are owned by the profiler, so events survive their thread
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _threads.push_back(std::make_unique<ThreadBuffer>());
+        buffer = _threads.back().get();
+        buffer->tid = static_cast<unsigned int>(_threads.size());
+        buffer->name = "thread " + std::to_string(buffer->tid);
+    }
+    return *buffer;
+}
+
+void Profiler::setThreadName(const char* name)
+{
+    // naming registers a buffer, so do not pay for it when not profiling
+    if (!enabled())
+        return;
+
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(_mutex);
+    buffer.name = name;
+}
+
+void Profiler::record(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    Slot& slot = buffer.slots[head & (ThreadBuffer::Capacity - 1)];
+
+    // invalidate the slot before overwriting it, see ThreadBuffer::read
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.beginNs.store(beginNs, std::memory_order_relaxed);
+    slot.endNs.store(endNs, std::memory_order_relaxed);
+    slot.sequence.store(head + 1, std::memory_order_release);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+bool Profiler::ThreadBuffer::read(uint64_t index, Event& event) const
+{
+    const Slot& slot = slots[index & (Capacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != index + 1)
+        return false;
+
+    event.name = slot.name.load(std::memory_order_relaxed);
+    event.beginNs = slot.beginNs.load(std::memory_order_relaxed);
+    event.endNs = slot.endNs.load(std::memory_order_relaxed);
+
+    // if the owner started rewriting the slot while it was copied, the sequence changed
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == index + 1;
+}
+
+void Profiler::addZoneTime(const char* name, uint64_t ns, bool newCall)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ZoneStats*& stats = _zonesByPointer[name];
+    if (!stats)
+        stats = &_zones[name];
+    stats->frameNs += ns;
+    if (newCall)
+        stats->calls++;
+}
+
+void Profiler::endFrame()
+{
+    if (!enabled())
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& buffer : _threads) {
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+
+        // events older than one buffer length have been overwritten, and the owning
+        // thread may overwrite more while they are read
+        uint64_t first = std::max(buffer->consumed, head > ThreadBuffer::Capacity ? head - ThreadBuffer::Capacity : 0);
+        for (uint64_t i = first; i < head; i++) {
+            Event e;
+            if (!buffer->read(i, e))
+                continue;
+
+            ZoneStats*& stats = _zonesByPointer[e.name];
+            if (!stats)
+                stats = &_zones[e.name];
+            stats->frameNs += e.endNs - e.beginNs;
+            stats->calls++;
+        }
+        buffer->consumed = head;
+    }
+
+    for (auto& [name, stats] : _zones) {
+        stats.totalNs += stats.frameNs;
+        stats.maxFrameNs = std::max(stats.maxFrameNs, stats.frameNs);
+        stats.frameNs = 0;
+    }
+    _windowFrames++;
+}
+
+double Profiler::averageMs(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _zones.find(name);
+    if (it == _zones.end() || _windowFrames == 0)
+        return 0.0;
+    return 1e-6 * it->second.totalNs / _windowFrames;
+}
+
+void Profiler::printAverages(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_windowFrames == 0)
+        return;
+
+    std::vector<std::pair<std::string, ZoneStats*>> zones;
+    for (auto& [name, stats] : _zones)
+        zones.emplace_back(name, &stats);
+    std::sort(zones.begin(), zones.end(), [](const auto& a, const auto& b) {
+        return a.second->totalNs > b.second->totalNs;
+    });
+
+    out << "PROFILER::STATS: averages over " << _windowFrames << " frames" << std::endl;
+    for (auto& [name, stats] : zones) {
+        if (stats->calls == 0)
+            continue;
+        out << "    " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(9) << 1e-6 * stats->totalNs / _windowFrames << " ms/frame"
+            << std::setw(9) << 1e-6 * stats->maxFrameNs << " ms max"
+            << std::setw(9) << std::setprecision(1) << double(stats->calls) / _windowFrames << " calls/frame"
+            << std::defaultfloat << std::endl;
+        *stats = ZoneStats();
+    }
+    _windowFrames = 0;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "PROFILER::ERROR: Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    size_t count = 0;
+    for (const auto& buffer : _threads) {
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+             << ",\"args\":{\"name\":\"" << buffer->name << "\"}}";
+        first = false;
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > ThreadBuffer::Capacity ? head - ThreadBuffer::Capacity : 0;
+        for (uint64_t i = begin; i < head; i++) {
+            Event e;
+            if (!buffer->read(i, e))
+                continue;
+            // complete events, timestamps in microseconds
+            file << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"glWater\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                 << std::fixed << std::setprecision(3)
+                 << ",\"ts\":" << 1e-3 * (e.beginNs - _startNs)
+                 << ",\"dur\":" << 1e-3 * (e.endNs - e.beginNs) << "}" << std::defaultfloat;
+            count++;
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+    std::cout << "PROFILER::INFO: Wrote " << count << " events to " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,156 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+
+/**
+ * CPU instrumentation with scoped zones. Every thread records begin/end timestamps of
+ * its zones into its own fixed size ring buffer, so recording needs no locks. Each slot
+ * carries the index of the event in it; readers check it before and after copying an
+ * event and drop events the owning thread overwrote meanwhile. When the profiler is
+ * disabled a zone costs a single branch.
+ *
+ * The GL thread calls endFrame() once per frame to fold new events into per-zone
+ * rolling averages; writeChromeTrace() dumps the events still held in the ring
+ * buffers as a Chrome trace_event file (load it in chrome://tracing or Perfetto).
+ *
+ * Zone names must be string literals (or otherwise outlive the profiler).
+ */
+class Profiler
+{
+    public:
+        static Profiler& instance();
+
+        static bool enabled() {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        void setEnabled(bool enabled) {
+            _enabled.store(enabled, std::memory_order_relaxed);
+        }
+
+        /* Name the calling thread in traces; call after enabling the profiler */
+        void setThreadName(const char* name);
+
+        /* Record a finished zone on the calling thread */
+        void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+        static uint64_t now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /**
+         * @brief Add time measured elsewhere, e.g. on the GPU, to a zone of the current frame.
+         *
+         * @param newCall false if the time continues a call already counted, e.g. a GPU
+         * zone resumed after a nested zone closed.
+         */
+        void addZoneTime(const char* name, uint64_t ns, bool newCall = true);
+
+        /* Fold the events of the finished frame into the rolling averages */
+        void endFrame();
+
+        /**
+         * @brief Print per-zone averages over the frames since the last print, then
+         * start a new window.
+         */
+        void printAverages(std::ostream& out = std::cout);
+
+        /* Average milliseconds per frame spent in a zone over the current window */
+        double averageMs(const std::string& name) const;
+
+        /* Write every event still in the ring buffers as Chrome trace_event JSON */
+        bool writeChromeTrace(const std::string& path) const;
+
+    private:
+        Profiler() = default;
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        struct Event {
+            const char* name;
+            uint64_t beginNs;
+            uint64_t endNs;
+        };
+
+        /* Ring buffer slot; every field is atomic so other threads may read it while it is rewritten */
+        struct Slot {
+            std::atomic<uint64_t> sequence{0};      // index + 1 of the event held, 0 while being written
+            std::atomic<const char*> name{nullptr};
+            std::atomic<uint64_t> beginNs{0};
+            std::atomic<uint64_t> endNs{0};
+        };
+
+        struct ThreadBuffer {
+            static constexpr size_t Capacity = 1 << 16;     // power of two
+
+            std::vector<Slot> slots = std::vector<Slot>(Capacity);
+            std::atomic<uint64_t> head{0};      // events written so far
+            uint64_t consumed = 0;              // events folded into the averages
+            unsigned int tid = 0;
+            std::string name;
+
+            /**
+             * @brief Copy event index, written by the owning thread.
+             * @return false if the slot no longer, or not yet, holds that event.
+             */
+            bool read(uint64_t index, Event& event) const;
+        };
+
+        struct ZoneStats {
+            uint64_t totalNs = 0;
+            uint64_t maxFrameNs = 0;
+            uint64_t frameNs = 0;       // accumulated in the current frame
+            unsigned long calls = 0;
+        };
+
+        ThreadBuffer& threadBuffer();
+
+    private:
+        static std::atomic<bool> _enabled;
+
+        mutable std::mutex _mutex;          // guards _threads, not the buffers themselves
+        std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+
+        std::unordered_map<std::string, ZoneStats> _zones;
+        std::unordered_map<const char*, ZoneStats*> _zonesByPointer;   // avoids hashing names per event
+        unsigned long _windowFrames = 0;
+        uint64_t _startNs = now();
+};
+
+/* RAII zone, see PROFILE_ZONE */
+class ProfileZone
+{
+    public:
+        explicit ProfileZone(const char* name)
+            : _name(Profiler::enabled() ? name : nullptr), _beginNs(_name ? Profiler::now() : 0) {}
+
+        ~ProfileZone() {
+            if (_name)
+                Profiler::instance().record(_name, _beginNs, Profiler::now());
+        }
+
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+
+    private:
+        const char* _name;
+        uint64_t _beginNs;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+/* Time the rest of the enclosing scope as a zone called name */
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone_, __LINE__)(name)
+
+#endif // PROFILER_H
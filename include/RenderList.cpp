@@ -0,0 +1,73 @@
+#include "RenderList.hpp"
+
+void RenderList::build(Scene& scene, const std::vector<Frustum>& frustums, const std::vector<glm::vec4>& clipPlanes)
+{
+    _items.clear();
+    _spheres.clear();
+
+    // world bounds are computed once here instead of once per pass
+    for (auto& light : scene.pointLights) {
+        _items.push_back({ nullptr, &light, light.worldBounds(), light.worldScale() });
+        _spheres.push_back(light.worldBoundingSphere());
+    }
+    for (auto& entity : scene.entities) {
+        _items.push_back({ &entity, nullptr, entity.worldBounds(), entity.worldScale() });
+        _spheres.push_back(entity.worldBoundingSphere());
+    }
+
+    const size_t n = _items.size();
+    _visible.resize(frustums.size() * n);
+    for (size_t f = 0; f < frustums.size(); f++) {
+        uint8_t* visible = _visible.data() + f * n;
+        for (size_t i = 0; i < n; i++) {
+            // cheap sphere rejection first, then the tighter box
+            visible[i] = frustums[f].intersects(_spheres[i]) && frustums[f].intersects(_items[i].bounds);
+        }
+    }
+
+    _sides.resize(clipPlanes.size() * n);
+    for (size_t p = 0; p < clipPlanes.size(); p++) {
+        PlaneSide* sides = _sides.data() + p * n;
+        for (size_t i = 0; i < n; i++) {
+            sides[i] = classify(_items[i].bounds, clipPlanes[p]);
+        }
+    }
+}
+
+void RenderList::submit(RenderQueue& queue, Shader* entityShader, Shader* lightShader,
+                        size_t cameraSlot, int clipPlane, CullStats& stats, const LodView* lod) const
+{
+    const size_t n = _items.size();
+    const uint8_t* visible = _visible.data() + cameraSlot * n;
+    const PlaneSide* sides = clipPlane == NoClipPlane ? nullptr : _sides.data() + clipPlane * n;
+
+    for (size_t i = 0; i < n; i++) {
+        const Item& item = _items[i];
+        if (!(item.entity ? entityShader : lightShader))
+            continue;
+
+        if (!visible[i]) {
+            stats.culled++;
+            continue;
+        }
+
+        unsigned int flags = 0;
+        if (sides) {
+            if (sides[i] == PlaneSide::Outside) {
+                stats.clipped++;
+                continue;
+            }
+            if (sides[i] == PlaneSide::Straddling) {
+                flags = RenderQueue::ClipPlane;
+                stats.straddling++;
+            }
+        }
+
+        float lodScale = lod ? lod->lodScale(_spheres[i], item.worldScale) : FLT_MAX;
+        if (item.entity)
+            item.entity->submit(queue, entityShader, flags, lodScale);
+        else
+            item.light->submit(queue, lightShader, flags, lodScale);
+        stats.visible++;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef RENDER_LIST_H
+#define RENDER_LIST_H
+
+#include <vector>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "Bounds.hpp"
+#include "Scene.hpp"
+#include "RenderQueue.hpp"
+
+/* Culling results, summed over all waters for the reflection/refraction passes */
+struct CullStats {
+    unsigned int visible = 0;
+    unsigned int culled = 0;        // outside the camera frustum
+    unsigned int clipped = 0;       // entirely on the clipped side of the pass's clip plane
+    unsigned int straddling = 0;    // visible and drawn with GL_CLIP_DISTANCE0
+    unsigned long triangles = 0;    // drawn, after picking levels of detail
+    unsigned int lights = 0;        // point lights shaded by the deferred renderer
+};
+
+/**
+ * What a pass sees, for picking levels of detail: the coarsest level whose error stays
+ * under maxPixelError once projected is drawn.
+ */
+struct LodView {
+    glm::vec3 eye;
+    float pixelScale;           // pixels per world unit at distance 1: targetHeight / (2 tan(fovY / 2))
+    float maxPixelError = 1.0f;
+
+    /* lodScale for RenderQueue::submit() of an object with the given bounds and world scale */
+    float lodScale(const BoundingSphere& sphere, float worldScale) const {
+        float distance = glm::length(sphere.center - eye) - sphere.radius;
+        if (distance <= 0.0f)
+            return FLT_MAX;
+        return worldScale * pixelScale / (distance * maxPixelError);
+    }
+};
+
+/**
+ * Every light source and entity of a scene with its world bounds, classified once per
+ * frame against each camera frustum and each clip plane. The main, reflection and
+ * refraction passes then only look up the results instead of re-walking and
+ * re-testing the scene. Objects on the kept side of a pass's clip plane are drawn
+ * without clipping, objects on the other side are skipped, and only those crossing
+ * the plane are drawn with GL_CLIP_DISTANCE0.
+ *
+ * Pointers into the scene are only valid for the frame the list was built in.
+ */
+class RenderList
+{
+    public:
+        static constexpr int NoClipPlane = -1;
+
+        /* Classify the scene; expects TransformStore::update() to have run this frame */
+        void build(Scene& scene, const std::vector<Frustum>& frustums, const std::vector<glm::vec4>& clipPlanes);
+
+        /**
+         * @brief Queue the objects visible from a camera slot.
+         *
+         * @param entityShader, lightShader Either may be nullptr to leave out entities or
+         * light sources, which are then not counted in stats either.
+         * @param clipPlane Index into the clip planes given to build(), or NoClipPlane.
+         * @param lod Picks each object's level of detail from its projected size; the
+         * full meshes are drawn without it.
+         */
+        void submit(RenderQueue& queue, Shader* entityShader, Shader* lightShader,
+                    size_t cameraSlot, int clipPlane, CullStats& stats, const LodView* lod = nullptr) const;
+
+    private:
+        struct Item {
+            Entity* entity;         // exactly one of entity and light is set
+            PointLight* light;
+            AABB bounds;
+            float worldScale;
+        };
+
+        std::vector<Item> _items;
+        std::vector<BoundingSphere> _spheres;  // only used for quick frustum rejection
+        std::vector<uint8_t> _visible;      // [cameraSlot * items + item]
+        std::vector<PlaneSide> _sides;      // [clipPlane * items + item]
+};
+
+#endif // RENDER_LIST_H
@@ -0,0 +1,167 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+
+RenderQueue::~RenderQueue()
+{
+    if (_instanceVBO)
+        glDeleteBuffers(1, &_instanceVBO);
+}
+
+void RenderQueue::submit(Shader* shader, const Model& model, const ObjectUniforms* object, unsigned int flags, float lodScale)
+{
+    for (const auto& mesh : model.meshes()) {
+        submit(shader, mesh, object, flags, mesh.selectLod(lodScale));
+    }
+}
+
+void RenderQueue::submit(Shader* shader, const Mesh& mesh, const ObjectUniforms* object, unsigned int flags, size_t lod)
+{
+    // clip | shader | material | VAO | LOD, most expensive state change in the highest bits
+    uint64_t materialId = (flags & UseMaterial) ? mesh.materialId() : 0;
+    uint64_t sortKey = (uint64_t((flags & ClipPlane) != 0) << 63)
+                     | (uint64_t(shader->ID & 0x7FFF) << 48)
+                     | ((materialId & 0xFFFFFF) << 24)
+                     | ((uint64_t(mesh.vao()) & 0xFFFFF) << 4)
+                     | (uint64_t(lod) & 0xF);
+
+    _items.push_back({ sortKey, shader, &mesh, object, flags, static_cast<uint8_t>(lod) });
+}
+
+/**
+ * @brief Gather the instance data of every instanced item (in sorted order) and
+ * upload it with a single buffer update.
+ */
+void RenderQueue::uploadInstances()
+{
+    _instances.clear();
+    for (const auto& item : _items) {
+        if (!(item.flags & Instanced))
+            continue;
+
+        const ObjectUniforms* object = item.object;
+        InstanceData instance;
+        instance.model = object->model;
+        for (int i = 0; i < 3; i++)
+            instance.invTransposeModel[i] = glm::vec3(object->invTransposeModel[i]);
+        instance.texCoordScale = object->texCoordScale;
+        _instances.push_back(instance);
+    }
+
+    if (_instances.empty())
+        return;
+
+    if (!_instanceVBO)
+        glGenBuffers(1, &_instanceVBO);
+
+    size_t size = _instances.size() * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, _instanceVBO);
+    if (size > _instanceCapacity) {
+        _instanceCapacity = size;
+        glBufferData(GL_ARRAY_BUFFER, size, _instances.data(), GL_STREAM_DRAW);
+    } else {
+        // orphan the old storage so we do not wait on the previous pass
+        glBufferData(GL_ARRAY_BUFFER, _instanceCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, _instances.data());
+    }
+}
+
+void RenderQueue::flush()
+{
+    std::stable_sort(_items.begin(), _items.end(), [](const DrawItem& a, const DrawItem& b) {
+        return a.sortKey < b.sortKey;
+    });
+
+    _stats = Stats();
+    uploadInstances();
+
+    Shader* shader = nullptr;
+    const ObjectUniforms* object = nullptr;
+    uint32_t materialId = UINT32_MAX;
+    unsigned int vao = 0;
+    bool clipping = false;      // GL_CLIP_DISTANCE0 is expected to be off between passes
+    size_t instanceIndex = 0;
+    Shader::Uniform modelLoc, invTransposeModelLoc, texCoordScaleLoc, colorLoc;
+
+    for (size_t i = 0; i < _items.size(); ) {
+        const DrawItem& item = _items[i];
+
+        // extend the run over following instances of the same mesh and shader
+        size_t runEnd = i + 1;
+        if ((item.flags & Instanced) && _instancing) {
+            while (runEnd < _items.size()
+                   && _items[runEnd].mesh == item.mesh
+                   && _items[runEnd].lod == item.lod
+                   && _items[runEnd].shader == item.shader
+                   && _items[runEnd].flags == item.flags)
+                runEnd++;
+        }
+
+        bool clip = (item.flags & ClipPlane) != 0;
+        if (clip != clipping) {
+            clipping = clip;
+            if (clipping)
+                glEnable(GL_CLIP_DISTANCE0);
+            else
+                glDisable(GL_CLIP_DISTANCE0);
+            _stats.clipChanges++;
+        }
+
+        if (item.shader != shader) {
+            shader = item.shader;
+            shader->use();
+            modelLoc = shader->uniform("model"_u);
+            invTransposeModelLoc = shader->uniform("invTransposeModel"_u);
+            texCoordScaleLoc = shader->uniform("texCoordScale"_u);
+            colorLoc = shader->uniform("color"_u);
+
+            // uniform state is per program
+            materialId = UINT32_MAX;
+            object = nullptr;
+            _stats.shaderChanges++;
+        }
+
+        if ((item.flags & UseMaterial) && item.mesh->materialId() != materialId) {
+            materialId = item.mesh->materialId();
+            item.mesh->material().apply(*shader);
+            _stats.materialChanges++;
+        }
+
+        if (!(item.flags & Instanced) && item.object != object) {
+            object = item.object;
+            shader->setMat4(modelLoc, object->model);
+            shader->setMat4(invTransposeModelLoc, object->invTransposeModel);
+            shader->setFloat(texCoordScaleLoc, object->texCoordScale);
+            shader->setVec3(colorLoc, object->color);
+            _stats.objectChanges++;
+        }
+
+        if (item.mesh->vao() != vao) {
+            vao = item.mesh->vao();
+            glBindVertexArray(vao);
+            item.mesh->applyVertexDecode();
+            _stats.vaoChanges++;
+        }
+
+        if (item.flags & Instanced) {
+            GLsizei count = static_cast<GLsizei>(runEnd - i);
+            item.mesh->bindInstanceAttributes(_instanceVBO, instanceIndex * sizeof(InstanceData));
+            item.mesh->drawElementsInstanced(count, item.lod);
+            instanceIndex += count;
+            _stats.instances += count;
+            _stats.triangles += count * (item.mesh->lod(item.lod).numIndices / 3);
+        } else {
+            item.mesh->drawElements(item.lod);
+            _stats.instances++;
+            _stats.triangles += item.mesh->lod(item.lod).numIndices / 3;
+        }
+        _stats.draws++;
+
+        i = runEnd;
+    }
+
+    if (clipping)
+        glDisable(GL_CLIP_DISTANCE0);
+    glBindVertexArray(0);
+    _items.clear();
+}
@@ -0,0 +1,106 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+
+#include "glm/glm.hpp"
+
+#include "Shader.hpp"
+#include "Mesh.hpp"
+#include "Model.hpp"
+
+/**
+ * Per-object uniforms shared by every mesh of one Entity/PointLight draw. Owned by
+ * the submitter and must outlive the queue's flush().
+ */
+struct ObjectUniforms {
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat4 invTransposeModel = glm::mat4(1.0f);
+    float texCoordScale = 1.0f;
+    glm::vec3 color = glm::vec3(1.0f);
+};
+
+/**
+ * Collects draw items for one pass, sorts them by clipping, shader, material and VAO
+ * and submits them while skipping redundant program, material, object and VAO changes.
+ * Consecutive instanced items of the same mesh are batched into one
+ * glDrawElementsInstanced call fed from a shared per-instance buffer.
+ */
+class RenderQueue
+{
+    public:
+        enum SubmitFlags : unsigned int {
+            UseMaterial = 1 << 0,   // shader reads the Material uniforms
+            Instanced   = 1 << 1,   // shader reads per-object data from InstanceData attributes
+            ClipPlane   = 1 << 2    // object crosses the clip plane, draw with GL_CLIP_DISTANCE0
+        };
+
+        struct Stats {
+            unsigned int draws = 0;
+            unsigned int instances = 0;
+            unsigned int shaderChanges = 0;
+            unsigned int materialChanges = 0;
+            unsigned int objectChanges = 0;
+            unsigned int vaoChanges = 0;
+            unsigned int clipChanges = 0;
+            unsigned long triangles = 0;
+        };
+
+        RenderQueue() = default;
+        ~RenderQueue();
+
+        RenderQueue(const RenderQueue&) = delete;
+        RenderQueue& operator=(const RenderQueue&) = delete;
+
+        void clear() {
+            _items.clear();
+        }
+
+        /**
+         * @brief Queue every mesh of a model. Shaders that do not use the material
+         * (e.g. the light source shader) should leave out UseMaterial so items are
+         * not split or re-sorted by material.
+         *
+         * @param lodScale Picks each mesh's level of detail, see Mesh::selectLod(). The
+         * default always draws the full meshes.
+         */
+        void submit(Shader* shader, const Model& model, const ObjectUniforms* object, unsigned int flags = UseMaterial,
+                    float lodScale = FLT_MAX);
+        void submit(Shader* shader, const Mesh& mesh, const ObjectUniforms* object, unsigned int flags = UseMaterial,
+                    size_t lod = 0);
+
+        /* Sort and draw everything queued, then clear the queue */
+        void flush();
+
+        /* When disabled, instanced items are drawn one instance per call (for comparisons) */
+        void setInstancing(bool enabled) {
+            _instancing = enabled;
+        }
+
+        const Stats& stats() const {
+            return _stats;
+        }
+
+    private:
+        struct DrawItem {
+            uint64_t sortKey;
+            Shader* shader;
+            const Mesh* mesh;
+            const ObjectUniforms* object;
+            unsigned int flags;
+            uint8_t lod;
+        };
+
+        void uploadInstances();
+
+        std::vector<DrawItem> _items;
+        std::vector<InstanceData> _instances;   // one per instanced item, in sorted order
+        GLuint _instanceVBO = 0;
+        size_t _instanceCapacity = 0;
+        bool _instancing = true;
+        Stats _stats;
+};
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,95 @@
+#include "ResourceManager.hpp"
+
+#include <filesystem>
+
+#include "Model.hpp"
+#include "TextureLoader.hpp"
+
+ResourceManager& ResourceManager::instance()
+{
+    static ResourceManager manager;
+    return manager;
+}
+
+std::string ResourceManager::canonicalPath(const std::string& path)
+{
+    std::error_code ec;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path : canonical.string();
+}
+
+std::shared_ptr<Model> ResourceManager::acquireModel(const std::string& path)
+{
+    std::string key = canonicalPath(path);
+
+    auto it = _models.find(key);
+    if (it != _models.end()) {
+        if (std::shared_ptr<Model> model = it->second.lock()) {
+            _modelHits++;
+            return model;
+        }
+    }
+
+    std::shared_ptr<Model> model = std::make_shared<Model>(path.c_str());
+    _models[key] = model;
+    _modelLoads++;
+    return model;
+}
+
+std::shared_ptr<Model> ResourceManager::findModel(const std::string& path)
+{
+    auto it = _models.find(canonicalPath(path));
+    if (it == _models.end())
+        return nullptr;
+
+    std::shared_ptr<Model> model = it->second.lock();
+    if (model)
+        _modelHits++;
+    return model;
+}
+
+void ResourceManager::addModel(const std::string& path, const std::shared_ptr<Model>& model)
+{
+    _models[canonicalPath(path)] = model;
+    _modelLoads++;
+}
+
+TextureHandle ResourceManager::acquireTexture(const std::string& path, TextureKind kind)
+{
+    // a normal map is compressed differently from the same file used for color
+    std::string canonical = canonicalPath(path);
+    std::string key = canonical + (kind == TextureKind::Normal ? "#normal" : "");
+
+    auto it = _textures.find(key);
+    if (it != _textures.end()) {
+        if (TextureHandle texture = it->second.lock()) {
+            _textureHits++;
+            return texture;
+        }
+    }
+
+    std::shared_ptr<TextureResource> texture = std::make_shared<TextureResource>();
+    texture->id = TextureLoader::instance().requestTexture2D(path, kind);
+    texture->path = canonical;
+    _textures[key] = texture;
+    _textureLoads++;
+    return texture;
+}
+
+void ResourceManager::printStats(std::ostream& out) const
+{
+    // GPU memory of the vertex and index buffers of the models still alive
+    size_t vertexBytes = 0, indexBytes = 0;
+    for (const auto& entry : _models) {
+        if (auto model = entry.second.lock()) {
+            for (const Mesh& mesh : model->meshes()) {
+                vertexBytes += mesh.vertexBytes();
+                indexBytes += mesh.indexBytes();
+            }
+        }
+    }
+
+    out << "RESOURCEMANAGER::STATS models: " << _modelLoads << " loaded, " << _modelHits << " shared, "
+        << vertexBytes / 1024 << " KiB of vertices, " << indexBytes / 1024 << " KiB of indices; "
+        << "textures: " << _textureLoads << " loaded, " << _textureHits << " shared" << std::endl;
+}
@@ -0,0 +1,70 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <iostream>
+
+#include "glad/glad.h"
+
+#include "TextureLoader.hpp"
+
+class Model;
+
+/**
+ * GL texture shared between every material that references the same image file.
+ * The texture is deleted when the last handle goes away.
+ */
+struct TextureResource {
+    GLuint id = 0;
+    std::string path;
+
+    ~TextureResource() {
+        glDeleteTextures(1, &id);
+    }
+};
+
+using TextureHandle = std::shared_ptr<const TextureResource>;
+
+/**
+ * Registry of loaded models and textures keyed by canonical file path. Handles are
+ * reference counted, so placing the same asset many times only costs a handle:
+ * the file is imported (and its textures uploaded) once, and released when the last
+ * Entity/PointLight/Model holding it is destroyed. Meshes are owned by their Model
+ * and therefore shared along with it.
+ *
+ * Must only be used from the thread that owns the GL context.
+ */
+class ResourceManager
+{
+    public:
+        static ResourceManager& instance();
+
+        std::shared_ptr<Model> acquireModel(const std::string& path);
+        TextureHandle acquireTexture(const std::string& path, TextureKind kind = TextureKind::Color);
+
+        /* The model if it is loaded, nullptr otherwise; never loads */
+        std::shared_ptr<Model> findModel(const std::string& path);
+
+        /* Register a model loaded elsewhere, e.g. streamed in by SceneStreamer */
+        void addModel(const std::string& path, const std::shared_ptr<Model>& model);
+
+        void printStats(std::ostream& out = std::cout) const;
+
+        static std::string canonicalPath(const std::string& path);
+
+    private:
+        ResourceManager() = default;
+        ResourceManager(const ResourceManager&) = delete;
+        ResourceManager& operator=(const ResourceManager&) = delete;
+
+    private:
+        std::unordered_map<std::string, std::weak_ptr<Model>> _models;
+        std::unordered_map<std::string, std::weak_ptr<const TextureResource>> _textures;
+
+        unsigned int _modelHits = 0, _modelLoads = 0;
+        unsigned int _textureHits = 0, _textureLoads = 0;
+};
+
+#endif // RESOURCE_MANAGER_H
@@ -8,6 +8,17 @@
 
 class Scene {
     public:
+        Scene() = default;
+
+        // owns the skybox and GL objects of the waters: movable, not copyable
+        Scene(Scene&& o) noexcept
+            : skyBox(o.skyBox), entities(std::move(o.entities)), pointLights(std::move(o.pointLights)),
+              dirLights(std::move(o.dirLights)), waters(std::move(o.waters)) {
+            o.skyBox = nullptr;
+        }
+        Scene(const Scene&) = delete;
+        Scene& operator=(const Scene&) = delete;
+
         ~Scene() {
             delete skyBox;
         }
@@ -0,0 +1,210 @@
+#include "SceneStreamer.hpp"
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#include "ResourceManager.hpp"
+#include "TextureLoader.hpp"
+#include "Profiler.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMs(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+SceneStreamer::SceneStreamer(Scene& scene)
+    : _scene(scene)
+{
+    // imports are mostly file reads and assimp post-processing; TextureLoader has its own pool
+    unsigned int numWorkers = std::max(2u, std::thread::hardware_concurrency() / 2);
+    for (unsigned int i = 0; i < numWorkers; i++)
+        _workers.emplace_back(&SceneStreamer::workerLoop, this);
+}
+
+SceneStreamer::~SceneStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _shutdown = true;
+    }
+    _jobReady.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+void SceneStreamer::addEntity(const std::string& path, EntitySetup setup, const AABB& placeholder)
+{
+    add(path, { std::move(setup), nullptr, placeholder });
+}
+
+void SceneStreamer::addPointLight(const std::string& path, PointLightSetup setup, const AABB& placeholder)
+{
+    add(path, { nullptr, std::move(setup), placeholder });
+}
+
+void SceneStreamer::add(const std::string& path, Placement placement)
+{
+    _pendingObjects++;
+
+    std::string key = ResourceManager::canonicalPath(path);
+    auto it = _byPath.find(key);
+    if (it != _byPath.end()) {
+        it->second->placements.push_back(std::move(placement));
+        return;
+    }
+
+    auto request = std::make_unique<Request>();
+    request->path = path;
+    request->placements.push_back(std::move(placement));
+    request->order = _order++;
+    _byPath[key] = request.get();
+
+    // already loaded: nothing to import, placed by the next update()
+    request->model = ResourceManager::instance().findModel(path);
+    if (request->model) {
+        request->imported = true;
+    } else {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(request.get());
+        _jobReady.notify_one();
+    }
+    _requests.push_back(std::move(request));
+}
+
+void SceneStreamer::workerLoop()
+{
+    Profiler::instance().setThreadName("model import");
+
+    while (true) {
+        Request* request;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobReady.wait(lock, [this] { return _shutdown || !_jobs.empty(); });
+            if (_shutdown)
+                return;
+
+            request = _jobs.front();
+            _jobs.pop_front();
+        }
+
+        // the request stays alive until it is imported and placed by the GL thread
+        ModelData data = Model::import(request->path);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            request->data = std::move(data);
+            request->imported = true;
+        }
+        _imported.notify_all();
+    }
+}
+
+SceneStreamer::Request* SceneStreamer::next(const Frustum* view, const glm::vec3& eye)
+{
+    if (_uploading)
+        return _uploading;
+
+    Request* best = nullptr;
+    float bestScore = std::numeric_limits<float>::infinity();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (const auto& request : _requests) {
+        if (!request->imported)
+            continue;
+
+        // in view and near first, then unknown placeholders, then out of view
+        float score = float(request->order);
+        if (view) {
+            score = std::numeric_limits<float>::max();
+            for (const Placement& p : request->placements) {
+                if (p.placeholder.empty())
+                    score = std::min(score, 1e20f);
+                else if (view->intersects(p.placeholder))
+                    score = std::min(score, glm::length(p.placeholder.center() - eye));
+                else
+                    score = std::min(score, 1e30f);
+            }
+        }
+
+        if (!best || score < bestScore) {
+            best = request.get();
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+size_t SceneStreamer::place(Request& request)
+{
+    for (Placement& p : request.placements) {
+        if (p.entity) {
+            _scene.entities.emplace_back(request.model);
+            p.entity(_scene.entities.back());
+        } else {
+            _scene.pointLights.emplace_back(request.model);
+            p.pointLight(_scene.pointLights.back());
+        }
+    }
+    return request.placements.size();
+}
+
+size_t SceneStreamer::update(double budgetMs, const Frustum* view, const glm::vec3& eye)
+{
+    auto start = Clock::now();
+    size_t placed = 0;
+    bool progressed = false;
+
+    // at least one mesh per call, so loading always moves on
+    while (!_requests.empty() && (!progressed || elapsedMs(start) < budgetMs)) {
+        Request* request = next(view, eye);
+        if (!request)
+            break;
+
+        if (!request->model) {
+            request->model = std::make_shared<Model>(std::move(request->data));
+            ResourceManager::instance().addModel(request->path, request->model);
+        }
+
+        _uploading = request;
+        progressed = true;
+        if (!request->model->uploadNextMesh())
+            continue;
+
+        _uploading = nullptr;
+        placed += place(*request);
+        _pendingObjects -= request->placements.size();
+
+        _byPath.erase(ResourceManager::canonicalPath(request->path));
+        _requests.erase(std::find_if(_requests.begin(), _requests.end(),
+                                     [request](const auto& r) { return r.get() == request; }));
+    }
+
+    // textures get what is left of the budget
+    if (TextureLoader::instance().pending() > 0)
+        TextureLoader::instance().update(budgetMs - elapsedMs(start));
+    return placed;
+}
+
+void SceneStreamer::finish()
+{
+    while (!_requests.empty()) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _imported.wait(lock, [this] {
+                return std::any_of(_requests.begin(), _requests.end(), [](const auto& r) { return r->imported; });
+            });
+        }
+        update(std::numeric_limits<double>::infinity());
+    }
+    TextureLoader::instance().finish();
+}
+
+bool SceneStreamer::done() const
+{
+    return _requests.empty() && TextureLoader::instance().pending() == 0;
+}
@@ -0,0 +1,111 @@
+#ifndef SCENE_STREAMER_H
+#define SCENE_STREAMER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unordered_map>
+
+#include "glm/glm.hpp"
+
+#include "Scene.hpp"
+#include "Bounds.hpp"
+
+/**
+ * Loads the models of a scene in the background. Worker threads read mesh caches or
+ * run the assimp import; the GL thread calls update() once per frame, which creates
+ * meshes within a time budget and places an object into the Scene as soon as its
+ * model is complete. Textures stream through TextureLoader in the same budget, so the
+ * first frame never waits for the scene to load, however large it is.
+ *
+ * Objects placed before their textures arrive render untextured for a few frames.
+ * Objects sharing a model are imported once and placed together.
+ */
+class SceneStreamer
+{
+    public:
+        using EntitySetup = std::function<void(Entity&)>;
+        using PointLightSetup = std::function<void(PointLight&)>;
+
+        explicit SceneStreamer(Scene& scene);
+        ~SceneStreamer();
+
+        SceneStreamer(const SceneStreamer&) = delete;
+        SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+        /**
+         * @brief Queue an entity; setup positions it once it has been placed.
+         *
+         * @param placeholder World bounds the entity is expected to occupy, if known.
+         * Models of entities in view are uploaded first, see update().
+         */
+        void addEntity(const std::string& path, EntitySetup setup, const AABB& placeholder = AABB());
+        void addPointLight(const std::string& path, PointLightSetup setup, const AABB& placeholder = AABB());
+
+        /**
+         * @brief Upload imported meshes and decoded textures for about budgetMs, placing
+         * every object whose model completes. Must be called on the GL thread.
+         *
+         * @param view Camera frustum; models whose placeholders it sees go first, nearest
+         * to eye first. Without it models are uploaded in the order they were queued.
+         * @return the number of objects placed into the scene.
+         */
+        size_t update(double budgetMs, const Frustum* view = nullptr, const glm::vec3& eye = glm::vec3(0.0f));
+
+        /* Load and place everything now, blocking */
+        void finish();
+
+        /* True once every object is placed and every texture uploaded */
+        bool done() const;
+
+        size_t pendingObjects() const {
+            return _pendingObjects;
+        }
+
+    private:
+        struct Placement {
+            EntitySetup entity;             // exactly one of the two is set
+            PointLightSetup pointLight;
+            AABB placeholder;
+        };
+
+        // one per distinct model
+        struct Request {
+            std::string path;
+            std::vector<Placement> placements;
+            size_t order;
+
+            ModelData data;                 // written by a worker
+            bool imported = false;          // guarded by _mutex
+            std::shared_ptr<Model> model;   // created on the GL thread from data
+        };
+
+        void add(const std::string& path, Placement placement);
+        Request* next(const Frustum* view, const glm::vec3& eye);
+        size_t place(Request& request);
+        void workerLoop();
+
+    private:
+        Scene& _scene;
+
+        std::vector<std::unique_ptr<Request>> _requests;       // only touched by the GL thread
+        std::unordered_map<std::string, Request*> _byPath;
+        Request* _uploading = nullptr;      // finished before starting another model
+        size_t _pendingObjects = 0;
+        size_t _order = 0;
+
+        std::vector<std::thread> _workers;
+        std::deque<Request*> _jobs;
+        bool _shutdown = false;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _jobReady;
+        std::condition_variable _imported;
+};
+
+#endif // SCENE_STREAMER_H
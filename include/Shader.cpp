@@ -1,5 +1,8 @@
 #include "Shader.hpp"
 
+#include <vector>
+#include <algorithm>
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
@@ -71,6 +74,70 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    reflectUniforms();
+}
+
+unsigned long Shader::_lookupsAvoided = 0;
+
+/**
+ * @brief Query every active uniform once after linking and store its location,
+ * keyed by the hash of its name. Array uniforms are registered both by their
+ * base name and by each element ("arr", "arr[0]", "arr[1]", ...).
+ */
+void Shader::reflectUniforms()
+{
+    GLint numUniforms = 0, maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &numUniforms);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::string name(std::max(maxNameLength, 1), '\0');
+    for (GLint i = 0; i < numUniforms; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(ID, i, maxNameLength, &length, &size, &type, &name[0]);
+
+        std::string uniformName = name.substr(0, length);
+        std::string baseName = uniformName;
+        size_t bracket = uniformName.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == uniformName.size())
+            baseName = uniformName.substr(0, bracket);
+
+        std::vector<std::string> names = { baseName };
+        if (baseName != uniformName) {
+            for (GLint element = 0; element < size; element++)
+                names.push_back(baseName + "[" + std::to_string(element) + "]");
+        }
+
+        for (const auto& n : names) {
+            GLint location = glGetUniformLocation(ID, n.c_str());
+            auto inserted = _uniformLocations.emplace(UniformName(n).hash, location);
+            if (!inserted.second && inserted.first->second != location) {
+                std::cout << "SHADER::WARNING: uniform name hash collision on " << n << std::endl;
+            }
+        }
+    }
+}
+
+void Shader::bindUniformBlock(const char* blockName, GLuint binding) const
+{
+    GLuint index = glGetUniformBlockIndex(ID, blockName);
+    if (index != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, index, binding);
+}
+
+Shader::Uniform Shader::uniform(UniformName name) const
+{
+    auto it = _uniformLocations.find(name.hash);
+    return Uniform { it == _uniformLocations.end() ? -1 : it->second };
+}
+
+unsigned long Shader::resetLookupsAvoided()
+{
+    unsigned long avoided = _lookupsAvoided;
+    _lookupsAvoided = 0;
+    return avoided;
 }
 
 void Shader::use() {
@@ -78,29 +145,71 @@ void Shader::use() {
 }
 
 void Shader::setBool(const std::string& name, bool value) const {         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    glUniform1i(location(name), (int)value); 
 }
 
 void Shader::setInt(const std::string& name, int value) const { 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1i(location(name), value); 
 }
 
 void Shader::setFloat(const std::string& name, float value) const { 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1f(location(name), value); 
 } 
 
 void Shader::setVec2(const std::string& name, glm::vec2 value) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), value.x, value.y);
+    glUniform2f(location(name), value.x, value.y);
 }
 
 void Shader::setVec3(const std::string& name, glm::vec3 value) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z);
+    glUniform3f(location(name), value.x, value.y, value.z);
 }
 
 void Shader::setVec4(const std::string& name, glm::vec4 value) const {
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), value.x, value.y, value.z, value.w);
+    glUniform4f(location(name), value.x, value.y, value.z, value.w);
 }
 
 void Shader::setMat4(const std::string& name, glm::mat4 value) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
-}
\ No newline at end of file
+    glUniformMatrix4fv(location(name), 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setBool(Uniform u, bool value) const {
+    if (u.location != -1)
+        _lookupsAvoided++;
+    glUniform1i(u.location, (int)value);
+}
+
+void Shader::setInt(Uniform u, int value) const {
+    if (u.location != -1)
+        _lookupsAvoided++;
+    glUniform1i(u.location, value);
+}
+
+void Shader::setFloat(Uniform u, float value) const {
+    if (u.location != -1)
+        _lookupsAvoided++;
+    glUniform1f(u.location, value);
+}
+
+void Shader::setVec2(Uniform u, glm::vec2 value) const {
+    if (u.location != -1)
+        _lookupsAvoided++;
+    glUniform2f(u.location, value.x, value.y);
+}
+
+void Shader::setVec3(Uniform u, glm::vec3 value) const {
+    if (u.location != -1)
+        _lookupsAvoided++;
+    glUniform3f(u.location, value.x, value.y, value.z);
+}
+
+void Shader::setVec4(Uniform u, glm::vec4 value) const {
+    if (u.location != -1)
+        _lookupsAvoided++;
+    glUniform4f(u.location, value.x, value.y, value.z, value.w);
+}
+
+void Shader::setMat4(Uniform u, glm::mat4 value) const {
+    if (u.location != -1)
+        _lookupsAvoided++;
+    glUniformMatrix4fv(u.location, 1, GL_FALSE, glm::value_ptr(value));
+}
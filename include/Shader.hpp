@@ -6,18 +6,56 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cstdint>
+#include <unordered_map>
 
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+/**
+ * Uniform name hashed with 32-bit FNV-1a. String literals can be hashed at compile
+ * time with the _u suffix ("model"_u), so hot-path uniform sets need neither a
+ * std::string nor a glGetUniformLocation call.
+ */
+struct UniformName {
+    uint32_t hash;
+
+    static constexpr uint32_t fnv1a(const char* s, size_t n) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < n; i++) {
+            h ^= static_cast<uint8_t>(s[i]);
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+    constexpr UniformName(const char* s, size_t n) : hash(fnv1a(s, n)) {}
+    explicit UniformName(const std::string& s) : hash(fnv1a(s.data(), s.size())) {}
+};
+
+constexpr UniformName operator""_u(const char* s, size_t n) {
+    return UniformName(s, n);
+}
+
 class Shader {
     public:
         unsigned int ID;    // program ID
 
+        /* Pre-resolved uniform location. Invalid handles (-1) are ignored by GL. */
+        struct Uniform {
+            GLint location = -1;
+        };
+
         Shader(const char* vertexPath, const char* fragmentPath);
 
         void use();
-        
+
+        /* Attach a uniform block to a binding point; no-op if the program does not use the block */
+        void bindUniformBlock(const char* blockName, GLuint binding) const;
+
+        /* Resolve a uniform once, e.g. at setup time, for use in hot loops */
+        Uniform uniform(UniformName name) const;
+
         void setBool(const std::string& name, bool value) const;
         void setInt(const std::string& name, int value) const;
         void setFloat(const std::string& name, float value) const;
@@ -25,7 +63,43 @@ class Shader {
         void setVec3(const std::string& name, glm::vec3 value) const;
         void setVec4(const std::string& name, glm::vec4 value) const;
         void setMat4(const std::string& name, glm::mat4 value) const;
+
+        void setBool(UniformName name, bool value) const { setBool(uniform(name), value); }
+        void setInt(UniformName name, int value) const { setInt(uniform(name), value); }
+        void setFloat(UniformName name, float value) const { setFloat(uniform(name), value); }
+        void setVec2(UniformName name, glm::vec2 value) const { setVec2(uniform(name), value); }
+        void setVec3(UniformName name, glm::vec3 value) const { setVec3(uniform(name), value); }
+        void setVec4(UniformName name, glm::vec4 value) const { setVec4(uniform(name), value); }
+        void setMat4(UniformName name, glm::mat4 value) const { setMat4(uniform(name), value); }
+
+        void setBool(Uniform u, bool value) const;
+        void setInt(Uniform u, int value) const;
+        void setFloat(Uniform u, float value) const;
+        void setVec2(Uniform u, glm::vec2 value) const;
+        void setVec3(Uniform u, glm::vec3 value) const;
+        void setVec4(Uniform u, glm::vec4 value) const;
+        void setMat4(Uniform u, glm::mat4 value) const;
+
+        /**
+         * @brief Number of sets by hashed name ("model"_u) or by a resolved Uniform that
+         * found their uniform in the location table since the last call, across all shaders;
+         * each of them used to cost a glGetUniformLocation. Sets by std::string are not
+         * counted. Call once per frame.
+         */
+        static unsigned long resetLookupsAvoided();
+
+    private:
+        void reflectUniforms();
+
+        /* Location of a uniform set by string name, not counted as an avoided lookup */
+        GLint location(const std::string& name) const {
+            return uniform(UniformName(name)).location;
+        }
+
+    private:
+        std::unordered_map<uint32_t, GLint> _uniformLocations;     // keyed by UniformName::hash
+        static unsigned long _lookupsAvoided;
 };
 
 
-#endif // SHADER_H
\ No newline at end of file
+#endif // SHADER_H
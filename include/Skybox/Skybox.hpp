@@ -3,6 +3,8 @@
 
 #include <vector>
 #include <string>
+#include <chrono>
+#include <iostream>
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
@@ -10,6 +12,8 @@
 
 #include "Shader.hpp"
 #include "Camera.hpp"
+#include "TextureLoader.hpp"
+#include "CubeMapFile.hpp"
 
 
 class Skybox 
@@ -26,8 +30,10 @@ class Skybox
          *                  GL_TEXTURE_CUBE_MAP_NEGATIVE_Y
          *                  GL_TEXTURE_CUBE_MAP_POSITIVE_Z
          *                  GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
+         * @param packedPath CubeMapFile holding the same faces. Loaded instead of the
+         *                  images if it exists, see main --pack-skybox.
          */
-        Skybox(const std::vector<std::string>& faces);
+        Skybox(const std::vector<std::string>& faces, const std::string& packedPath = "");
 
         ~Skybox();
 
@@ -41,6 +47,7 @@ class Skybox
 
     private:
         GLuint initCubeMap(const std::vector<std::string>& faces);
+        GLuint initPackedCubeMap(const std::string& path);
         GLuint initVertices();
         void updateUniforms(Shader* shader);
 
@@ -94,43 +101,45 @@ class Skybox
         };
 };
 
-Skybox::Skybox(const std::vector<std::string>& faces)
+inline Skybox::Skybox(const std::vector<std::string>& faces, const std::string& packedPath)
 {
     for (auto& elem : skyBoxVertices)
         elem *= 0.99f;
         
-    cubeMapTexture = initCubeMap(faces);
+    cubeMapTexture = packedPath.empty() ? 0 : initPackedCubeMap(packedPath);
+    if (!cubeMapTexture)
+        cubeMapTexture = initCubeMap(faces);
     cubeMapVAO = initVertices();
 }
 
-Skybox::~Skybox()
+inline Skybox::~Skybox()
 {
     glDeleteBuffers(1, &cubeMapVBO);
     glDeleteVertexArrays(1, &cubeMapVAO);
 }
 
-GLuint Skybox::initCubeMap(const std::vector<std::string>& faces)
+inline GLuint Skybox::initCubeMap(const std::vector<std::string>& faces)
 {
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
 
-    int width, height, numChannels;
+    // faces are decoded in parallel and uploaded by TextureLoader::finish()
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &numChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
-                         0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-            );
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap tex failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
+        TextureLoader::instance().request(faces[i], [texture, i](const DecodedImage& image) {
+            if (image.data)
+            {
+                glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 
+                             0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data
+                );
+            }
+            else
+            {
+                std::cout << "Cubemap tex failed to load at path: " << image.path << std::endl;
+            }
+        }, 3);
     }
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -143,7 +152,38 @@ GLuint Skybox::initCubeMap(const std::vector<std::string>& faces)
 
 }
 
-GLuint Skybox::initVertices()
+inline GLuint Skybox::initPackedCubeMap(const std::string& path)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    CubeMapFile file(path);
+    if (!file.load())
+        return 0;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    if (!file.upload(texture)) {
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // the mips are filtered per face; let the coarse levels blend across face edges
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "SKYBOX::INFO: " << path << ": 6 x " << file.faceSize() << "x" << file.faceSize()
+              << (file.format() == CubeMapFile::BC1 ? " BC1, " : " RGBA8, ") << file.levelCount() << " levels, "
+              << file.bytes() / 1024 << " KiB loaded in " << ms << " ms" << std::endl;
+    return texture;
+}
+
+inline GLuint Skybox::initVertices()
 {
     GLuint VAO;
     glGenVertexArrays(1, &VAO);
@@ -159,12 +199,12 @@ GLuint Skybox::initVertices()
     return VAO;
 }
 
-void Skybox::updateUniforms(Shader* shader)
+inline void Skybox::updateUniforms(Shader* shader)
 {
-    shader->setFloat("exposure", 0.2);
+    shader->setFloat("exposure"_u, 0.2);
 }
 
-void Skybox::draw(Shader* shader)
+inline void Skybox::draw(Shader* shader)
 {
     updateUniforms(shader);
     glDepthMask(GL_FALSE);
@@ -2,14 +2,18 @@
 
 layout (location = 0) in vec3 aPos;         // world space
 
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
 
 out vec3 fTexCoord;
 
 void main()
 {
     fTexCoord = aPos;
-    vec4 pos = projection * view * vec4(aPos, 1.0f);
+    mat4 viewWithoutTranslation = mat4(mat3(view));
+    vec4 pos = projection * viewWithoutTranslation * vec4(aPos, 1.0f);
     gl_Position = pos.xyww;
 }
\ No newline at end of file
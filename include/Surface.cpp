@@ -0,0 +1,213 @@
+#include "Surface.hpp"
+
+#include <iostream>
+
+#ifdef GLWATER_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+Surface::Surface(GLFWwindow* window)
+    : _window(window)
+{
+}
+
+#ifdef GLWATER_EGL
+namespace {
+    EGLDisplay headlessDisplay()
+    {
+        // the surfaceless platform needs neither a display server nor a GPU
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+                return display;
+        }
+
+        EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+            return display;
+        return EGL_NO_DISPLAY;
+    }
+}
+#endif
+
+Surface* Surface::createHeadless(int width, int height)
+{
+    Surface* surface = new Surface();
+
+#ifdef GLWATER_EGL
+    EGLDisplay display = headlessDisplay();
+    if (display == EGL_NO_DISPLAY) {
+        std::cout << "SURFACE::ERROR: Could not initialize an EGL display" << std::endl;
+        delete surface;
+        return nullptr;
+    }
+    surface->_eglDisplay = display;
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    const EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0
+        || !eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "SURFACE::ERROR: No EGL config supports desktop OpenGL" << std::endl;
+        delete surface;
+        return nullptr;
+    }
+
+    surface->_eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (surface->_eglContext == EGL_NO_CONTEXT) {
+        std::cout << "SURFACE::ERROR: Could not create an OpenGL 3.3 core EGL context" << std::endl;
+        delete surface;
+        return nullptr;
+    }
+
+    // a tiny pbuffer keeps this working on EGL implementations without surfaceless contexts;
+    // everything is drawn into the offscreen framebuffer
+    surface->_eglSurface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+    if (!eglMakeCurrent(display, surface->_eglSurface, surface->_eglSurface, surface->_eglContext)) {
+        std::cout << "SURFACE::ERROR: Could not make the EGL context current" << std::endl;
+        delete surface;
+        return nullptr;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        delete surface;
+        return nullptr;
+    }
+#else
+    // no EGL: a hidden window still needs a display, but nothing is ever shown
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    surface->_window = glfwCreateWindow(width, height, "glWater", NULL, NULL);
+    if (surface->_window == NULL) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        delete surface;
+        return nullptr;
+    }
+    glfwMakeContextCurrent(surface->_window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        delete surface;
+        return nullptr;
+    }
+#endif
+
+    if (!surface->initFramebuffer(width, height)) {
+        delete surface;
+        return nullptr;
+    }
+    return surface;
+}
+
+bool Surface::initFramebuffer(int width, int height)
+{
+    _width = width;
+    _height = height;
+
+    glGenFramebuffers(1, &_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+
+    glGenRenderbuffers(1, &_colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _colorBuffer);
+
+    glGenRenderbuffers(1, &_depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "SURFACE::ERROR: Offscreen framebuffer is incomplete" << std::endl;
+        return false;
+    }
+
+    bindFramebuffer();
+    return true;
+}
+
+Surface::~Surface()
+{
+    if (_framebuffer != 0 && (_window || _eglContext)) {
+        glDeleteFramebuffers(1, &_framebuffer);
+        glDeleteRenderbuffers(1, &_colorBuffer);
+        glDeleteRenderbuffers(1, &_depthBuffer);
+    }
+
+#ifdef GLWATER_EGL
+    if (_eglDisplay) {
+        eglMakeCurrent(_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (_eglSurface)
+            eglDestroySurface(_eglDisplay, _eglSurface);
+        if (_eglContext)
+            eglDestroyContext(_eglDisplay, _eglContext);
+        eglTerminate(_eglDisplay);
+    }
+#endif
+}
+
+void Surface::framebufferSize(int& width, int& height) const
+{
+    if (headless()) {
+        width = _width;
+        height = _height;
+    } else {
+        glfwGetFramebufferSize(_window, &width, &height);
+    }
+}
+
+void Surface::bindFramebuffer() const
+{
+    int width, height;
+    framebufferSize(width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+    glViewport(0, 0, width, height);
+}
+
+double Surface::time() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+}
+
+bool Surface::shouldClose() const
+{
+    return _window && glfwWindowShouldClose(_window);
+}
+
+void Surface::present()
+{
+    // offscreen frames are not shown, flush so the GPU keeps working on them
+    if (headless())
+        glFlush();
+    else
+        glfwSwapBuffers(_window);
+}
+
+void Surface::pollEvents()
+{
+    if (_window)
+        glfwPollEvents();
+}
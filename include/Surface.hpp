@@ -0,0 +1,77 @@
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include <chrono>
+
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+
+/**
+ * What the application presents to: either a GLFW window, or in headless mode an
+ * offscreen framebuffer that stands in for the default framebuffer.
+ *
+ * Headless surfaces get their context from EGL when built with GLWATER_EGL (surfaceless
+ * Mesa platform first, so llvmpipe works without a display or GPU), and from a hidden
+ * GLFW window otherwise. Either way nothing is shown and frames are never waited on.
+ */
+class Surface
+{
+    public:
+        /* Wrap a window whose context is current and loaded */
+        explicit Surface(GLFWwindow* window);
+
+        /**
+         * @brief Create an offscreen GL 3.3 core context and framebuffer.
+         * @return nullptr if no context could be created.
+         */
+        static Surface* createHeadless(int width, int height);
+
+        ~Surface();
+
+        Surface(const Surface&) = delete;
+        Surface& operator=(const Surface&) = delete;
+
+        bool headless() const {
+            return _framebuffer != 0;
+        }
+
+        /* The GLFW window, nullptr for EGL headless surfaces */
+        GLFWwindow* window() const {
+            return _window;
+        }
+
+        void framebufferSize(int& width, int& height) const;
+
+        /* Bind the framebuffer frames are presented from and set the viewport to it */
+        void bindFramebuffer() const;
+
+        /* Seconds since the surface was created */
+        double time() const;
+
+        bool shouldClose() const;
+        void present();
+        void pollEvents();
+
+    private:
+        Surface() = default;
+
+        bool initFramebuffer(int width, int height);
+
+    private:
+        GLFWwindow* _window = nullptr;
+
+        // offscreen target of headless surfaces
+        GLuint _framebuffer = 0;
+        GLuint _colorBuffer = 0;
+        GLuint _depthBuffer = 0;
+        int _width = 0, _height = 0;
+
+        // EGLDisplay, EGLContext, EGLSurface; kept opaque so EGL stays out of the header
+        void* _eglDisplay = nullptr;
+        void* _eglContext = nullptr;
+        void* _eglSurface = nullptr;
+
+        std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+};
+
+#endif // SURFACE_H
@@ -0,0 +1,162 @@
+#include "TextureCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <thread>
+#include <functional>
+
+#include <sys/stat.h>
+
+/**
+ * File layout (native endianness):
+ *
+ *  FileHeader
+ *  source path (pathLength bytes)
+ *  for each level, largest first:
+ *      LevelHeader
+ *      compressed blocks (size bytes)
+ */
+namespace {
+
+    const char kMagic[4] = { 'G', 'L', 'W', 'T' };
+    const uint32_t kVersion = 1;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        int64_t sourceMTime;
+        uint64_t sourceSize;
+        uint32_t normalMap;
+        uint32_t format;
+        uint32_t numLevels;
+        uint32_t pathLength;
+    };
+
+    struct LevelHeader {
+        uint32_t width;
+        uint32_t height;
+        uint32_t size;
+    };
+
+    // bytes a level of this size and format must hold
+    size_t levelSize(texcomp::BlockFormat format, uint32_t width, uint32_t height) {
+        return size_t((width + 3) / 4) * ((height + 3) / 4) * texcomp::blockBytes(format);
+    }
+}
+
+TextureCache::TextureCache(const std::string& sourcePath, bool normalMap)
+    : _sourcePath(sourcePath), _cachePath(sourcePath + (normalMap ? ".normal.texcache" : ".texcache")), _normalMap(normalMap)
+{
+}
+
+bool TextureCache::sourceStamp(int64_t& mtime, uint64_t& size) const
+{
+    struct stat st;
+    if (stat(_sourcePath.c_str(), &st) != 0)
+        return false;
+
+    mtime = static_cast<int64_t>(st.st_mtime);
+    size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+bool TextureCache::load(texcomp::CompressedImage& image) const
+{
+    int64_t mtime;
+    uint64_t sourceSize;
+    if (!sourceStamp(mtime, sourceSize))
+        return false;
+
+    std::ifstream in(_cachePath, std::ios::binary);
+    if (!in)
+        return false;
+
+    FileHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+
+    bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+        && header.version == kVersion
+        && header.sourceMTime == mtime
+        && header.sourceSize == sourceSize
+        && header.normalMap == (_normalMap ? 1u : 0u)
+        && (header.format == uint32_t(texcomp::BlockFormat::BC1)
+            || header.format == uint32_t(texcomp::BlockFormat::BC3)
+            || header.format == uint32_t(texcomp::BlockFormat::BC5))
+        && header.pathLength == _sourcePath.size();
+    if (!valid)
+        return false;
+
+    std::string path(header.pathLength, '\0');
+    if (!in.read(&path[0], header.pathLength) || path != _sourcePath)
+        return false;
+
+    texcomp::CompressedImage result;
+    result.format = static_cast<texcomp::BlockFormat>(header.format);
+    for (uint32_t i = 0; i < header.numLevels; i++) {
+        LevelHeader lh;
+        if (!in.read(reinterpret_cast<char*>(&lh), sizeof(lh)) || lh.size != levelSize(result.format, lh.width, lh.height))
+            return false;
+
+        texcomp::MipLevel level { lh.width, lh.height, std::vector<uint8_t>(lh.size) };
+        if (!in.read(reinterpret_cast<char*>(level.data.data()), lh.size))
+            return false;
+        result.levels.push_back(std::move(level));
+    }
+
+    if (result.levels.empty())
+        return false;
+
+    image = std::move(result);
+    return true;
+}
+
+bool TextureCache::write(const texcomp::CompressedImage& image) const
+{
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.normalMap = _normalMap ? 1u : 0u;
+    header.format = static_cast<uint32_t>(image.format);
+    header.numLevels = static_cast<uint32_t>(image.levels.size());
+    header.pathLength = static_cast<uint32_t>(_sourcePath.size());
+    if (!sourceStamp(header.sourceMTime, header.sourceSize))
+        return false;
+
+    // write to a temporary file first so a crash never leaves a truncated cache behind;
+    // one per thread, as two loader workers may compress the same image
+    std::string tmpPath = _cachePath + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "TEXTURECACHE::ERROR: Could not open " << tmpPath << " for writing" << std::endl;
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(_sourcePath.data(), _sourcePath.size());
+    for (const auto& level : image.levels) {
+        LevelHeader lh { level.width, level.height, static_cast<uint32_t>(level.data.size()) };
+        out.write(reinterpret_cast<const char*>(&lh), sizeof(lh));
+        out.write(reinterpret_cast<const char*>(level.data.data()), level.data.size());
+    }
+
+    out.close();
+    if (!out) {
+        std::cout << "TEXTURECACHE::ERROR: Failed to write " << tmpPath << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, _cachePath, ec);
+    if (ec) {
+        std::cout << "TEXTURECACHE::ERROR: Could not replace " << _cachePath << ": " << ec.message() << std::endl;
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <string>
+#include <cstdint>
+
+#include "TextureCompressor.hpp"
+
+/**
+ * On-disk cache of a block-compressed texture and its mip chain. A cache file lives
+ * next to its source image (<source>.texcache, or <source>.normal.texcache when encoded
+ * as a normal map) and is keyed by the source path, its modification time and size. Any
+ * mismatch, or a bump of the format version, makes the cache stale and the image is
+ * decoded and compressed again.
+ */
+class TextureCache
+{
+    public:
+        TextureCache(const std::string& sourcePath, bool normalMap);
+
+        /**
+         * @brief Read the cached levels into image.
+         *
+         * @return true if the cache exists and is up to date.
+         */
+        bool load(texcomp::CompressedImage& image) const;
+
+        /**
+         * @brief Write image to the cache file, replacing any stale copy.
+         *
+         * @return true on success.
+         */
+        bool write(const texcomp::CompressedImage& image) const;
+
+        std::string cachePath() const {
+            return _cachePath;
+        }
+
+    private:
+        bool sourceStamp(int64_t& mtime, uint64_t& size) const;
+
+    private:
+        std::string _sourcePath;
+        std::string _cachePath;
+        bool _normalMap;
+};
+
+#endif // TEXTURE_CACHE_H
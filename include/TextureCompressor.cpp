@@ -0,0 +1,377 @@
+#include "TextureCompressor.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+namespace {
+
+    uint16_t to565(const glm::vec3& c)
+    {
+        int r = int(std::lround(glm::clamp(c.r, 0.0f, 255.0f) * 31.0f / 255.0f));
+        int g = int(std::lround(glm::clamp(c.g, 0.0f, 255.0f) * 63.0f / 255.0f));
+        int b = int(std::lround(glm::clamp(c.b, 0.0f, 255.0f) * 31.0f / 255.0f));
+        return uint16_t((r << 11) | (g << 5) | b);
+    }
+
+    // the color a decoder expands a 565 endpoint to
+    glm::vec3 from565(uint16_t c)
+    {
+        int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+    }
+
+    float distance2(const glm::vec3& a, const glm::vec3& b)
+    {
+        glm::vec3 d = a - b;
+        return glm::dot(d, d);
+    }
+
+    /**
+     * Pick the nearest of the four palette entries for every texel of a 4-color block
+     * (c0 > c1), writing the 2-bit indices. Returns the summed squared error.
+     */
+    float fitIndices(const glm::vec3 colors[16], uint16_t c0, uint16_t c1, uint32_t& indices)
+    {
+        glm::vec3 a = from565(c0), b = from565(c1);
+        glm::vec3 palette[4] = { a, b, (2.0f * a + b) / 3.0f, (a + 2.0f * b) / 3.0f };
+
+        float error = 0.0f;
+        indices = 0;
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            float bestError = distance2(colors[i], palette[0]);
+            for (int p = 1; p < 4; p++) {
+                float e = distance2(colors[i], palette[p]);
+                if (e < bestError) {
+                    best = p;
+                    bestError = e;
+                }
+            }
+            indices |= uint32_t(best) << (2 * i);
+            error += bestError;
+        }
+        return error;
+    }
+
+    /**
+     * Least-squares endpoints for fixed indices: minimizes the distance of every texel
+     * to its palette entry, which is a fixed blend of the two endpoints.
+     */
+    bool refineEndpoints(const glm::vec3 colors[16], uint32_t indices, glm::vec3& a, glm::vec3& b)
+    {
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        glm::vec3 ax(0.0f), bx(0.0f);
+        for (int i = 0; i < 16; i++) {
+            float alpha = weights[(indices >> (2 * i)) & 3];
+            float beta = 1.0f - alpha;
+            aa += alpha * alpha;
+            ab += alpha * beta;
+            bb += beta * beta;
+            ax += alpha * colors[i];
+            bx += beta * colors[i];
+        }
+
+        float det = aa * bb - ab * ab;
+        if (std::abs(det) < 1e-6f)
+            return false;
+
+        a = (ax * bb - bx * ab) / det;
+        b = (bx * aa - ax * ab) / det;
+        return true;
+    }
+
+    void writeColorBlock(uint16_t c0, uint16_t c1, uint32_t indices, uint8_t out[8])
+    {
+        out[0] = uint8_t(c0);
+        out[1] = uint8_t(c0 >> 8);
+        out[2] = uint8_t(c1);
+        out[3] = uint8_t(c1 >> 8);
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = uint8_t(indices >> (8 * i));
+    }
+
+    /* Quantize the endpoints and fit indices; endpoints are ordered for the 4-color mode */
+    float encodeEndpoints(const glm::vec3 colors[16], const glm::vec3& a, const glm::vec3& b,
+                          uint16_t& c0, uint16_t& c1, uint32_t& indices)
+    {
+        c0 = to565(a);
+        c1 = to565(b);
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        // equal endpoints select the 3-color mode, where index 3 is black: use index 0 only
+        if (c0 == c1) {
+            indices = 0;
+            float error = 0.0f;
+            for (int i = 0; i < 16; i++)
+                error += distance2(colors[i], from565(c0));
+            return error;
+        }
+        return fitIndices(colors, c0, c1, indices);
+    }
+
+    /* One channel as in BC3 alpha and BC5: two 8-bit endpoints and 3-bit indices */
+    void encodeChannel(const uint8_t rgba[64], int channel, uint8_t out[8])
+    {
+        int lo = 255, hi = 0;
+        for (int i = 0; i < 16; i++) {
+            lo = std::min(lo, int(rgba[4 * i + channel]));
+            hi = std::max(hi, int(rgba[4 * i + channel]));
+        }
+
+        out[0] = uint8_t(hi);
+        out[1] = uint8_t(lo);
+        uint64_t indices = 0;
+
+        // hi > lo selects the 8-value mode: hi, lo and six blends in between
+        if (hi > lo) {
+            int palette[8] = { hi, lo };
+            for (int s = 1; s < 7; s++)
+                palette[s + 1] = ((7 - s) * hi + s * lo + 3) / 7;
+
+            for (int i = 0; i < 16; i++) {
+                int value = rgba[4 * i + channel];
+                int best = 0;
+                for (int p = 1; p < 8; p++) {
+                    if (std::abs(palette[p] - value) < std::abs(palette[best] - value))
+                        best = p;
+                }
+                indices |= uint64_t(best) << (3 * i);
+            }
+        }
+
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = uint8_t(indices >> (8 * i));
+    }
+}
+
+namespace texcomp {
+
+    // 2x2 box filter; odd sizes repeat the last row/column
+    std::vector<uint8_t> downsample(const uint8_t* src, uint32_t width, uint32_t height, bool normalMap)
+    {
+        uint32_t w = std::max(1u, width / 2), h = std::max(1u, height / 2);
+        std::vector<uint8_t> dst(size_t(w) * h * 4);
+
+        for (uint32_t y = 0; y < h; y++) {
+            for (uint32_t x = 0; x < w; x++) {
+                uint32_t x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+                uint32_t y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+                const uint8_t* texels[4] = {
+                    &src[(size_t(y0) * width + x0) * 4], &src[(size_t(y0) * width + x1) * 4],
+                    &src[(size_t(y1) * width + x0) * 4], &src[(size_t(y1) * width + x1) * 4]
+                };
+                uint8_t* out = &dst[(size_t(y) * w + x) * 4];
+
+                if (normalMap) {
+                    // average the decoded vectors, so the coarser levels keep unit normals
+                    glm::vec3 n(0.0f);
+                    for (const uint8_t* t : texels)
+                        n += glm::vec3(t[0], t[1], t[2]) / 127.5f - 1.0f;
+                    n = glm::length(n) > 1e-6f ? glm::normalize(n) : glm::vec3(0.0f, 0.0f, 1.0f);
+                    for (int c = 0; c < 3; c++)
+                        out[c] = uint8_t(std::lround((n[c] + 1.0f) * 127.5f));
+                    out[3] = 255;
+                } else {
+                    for (int c = 0; c < 4; c++)
+                        out[c] = uint8_t((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                }
+            }
+        }
+        return dst;
+    }
+
+    bool s3tcSupported()
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension && std::strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+                return true;
+        }
+        return false;
+    }
+
+    size_t CompressedImage::bytes() const
+    {
+        size_t total = 0;
+        for (const auto& level : levels)
+            total += level.data.size();
+        return total;
+    }
+
+    size_t blockBytes(BlockFormat format)
+    {
+        return format == BlockFormat::BC1 ? 8 : 16;
+    }
+
+    GLenum glInternalFormat(BlockFormat format)
+    {
+        switch (format) {
+            case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        }
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    }
+
+    const char* formatName(BlockFormat format)
+    {
+        switch (format) {
+            case BlockFormat::BC1: return "BC1";
+            case BlockFormat::BC3: return "BC3";
+            case BlockFormat::BC5: return "BC5";
+        }
+        return "?";
+    }
+
+    size_t uncompressedBytes(uint32_t width, uint32_t height, bool mipmapped)
+    {
+        size_t total = size_t(width) * height * 4;
+        while (mipmapped && (width > 1 || height > 1)) {
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+            total += size_t(width) * height * 4;
+        }
+        return total;
+    }
+
+    void encodeBC1(const uint8_t rgba[64], uint8_t out[8])
+    {
+        glm::vec3 colors[16];
+        glm::vec3 mean(0.0f);
+        for (int i = 0; i < 16; i++) {
+            colors[i] = glm::vec3(rgba[4 * i], rgba[4 * i + 1], rgba[4 * i + 2]);
+            mean += colors[i] / 16.0f;
+        }
+
+        // principal axis of the colors by power iteration on their covariance
+        glm::mat3 covariance(0.0f);
+        for (int i = 0; i < 16; i++) {
+            glm::vec3 d = colors[i] - mean;
+            covariance += glm::outerProduct(d, d);
+        }
+
+        glm::vec3 axis(1.0f, 1.0f, 1.0f);
+        for (int iteration = 0; iteration < 8; iteration++) {
+            axis = covariance * axis;
+            float length = glm::length(axis);
+            if (length < 1e-6f)
+                break;
+            axis /= length;
+        }
+
+        // endpoints at the extremes of the colors along the axis
+        glm::vec3 a = colors[0], b = colors[0];
+        float lo = glm::dot(colors[0], axis), hi = lo;
+        for (int i = 1; i < 16; i++) {
+            float t = glm::dot(colors[i], axis);
+            if (t > hi) {
+                hi = t;
+                a = colors[i];
+            }
+            if (t < lo) {
+                lo = t;
+                b = colors[i];
+            }
+        }
+
+        uint16_t c0, c1;
+        uint32_t indices;
+        float error = encodeEndpoints(colors, a, b, c0, c1, indices);
+
+        // the extremes overshoot the blends in between; least squares usually does better
+        for (int iteration = 0; iteration < 2 && error > 0.0f && c0 != c1; iteration++) {
+            glm::vec3 ra = from565(c0), rb = from565(c1);
+            if (!refineEndpoints(colors, indices, ra, rb))
+                break;
+
+            uint16_t r0, r1;
+            uint32_t rIndices;
+            float rError = encodeEndpoints(colors, ra, rb, r0, r1, rIndices);
+            if (rError >= error)
+                break;
+
+            c0 = r0;
+            c1 = r1;
+            indices = rIndices;
+            error = rError;
+        }
+
+        writeColorBlock(c0, c1, indices, out);
+    }
+
+    void encodeBC3(const uint8_t rgba[64], uint8_t out[16])
+    {
+        encodeChannel(rgba, 3, out);
+        encodeBC1(rgba, out + 8);
+    }
+
+    void encodeBC5(const uint8_t rgba[64], uint8_t out[16])
+    {
+        encodeChannel(rgba, 0, out);
+        encodeChannel(rgba, 1, out + 8);
+    }
+
+    std::vector<uint8_t> compressLevel(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format)
+    {
+        uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+        size_t size = blockBytes(format);
+        std::vector<uint8_t> data(size_t(blocksX) * blocksY * size);
+
+        uint8_t block[64];
+        for (uint32_t by = 0; by < blocksY; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                for (uint32_t y = 0; y < 4; y++) {
+                    for (uint32_t x = 0; x < 4; x++) {
+                        uint32_t sx = std::min(4 * bx + x, width - 1), sy = std::min(4 * by + y, height - 1);
+                        const uint8_t* texel = rgba + (size_t(sy) * width + sx) * 4;
+                        std::copy(texel, texel + 4, block + 4 * (4 * y + x));
+                    }
+                }
+
+                uint8_t* out = &data[(size_t(by) * blocksX + bx) * size];
+                if (format == BlockFormat::BC1)
+                    encodeBC1(block, out);
+                else if (format == BlockFormat::BC3)
+                    encodeBC3(block, out);
+                else
+                    encodeBC5(block, out);
+            }
+        }
+        return data;
+    }
+
+    CompressedImage compress(const uint8_t* rgba, uint32_t width, uint32_t height, bool normalMap)
+    {
+        CompressedImage image;
+        if (normalMap) {
+            image.format = BlockFormat::BC5;
+        } else {
+            size_t numTexels = size_t(width) * height;
+            bool opaque = true;
+            for (size_t i = 0; i < numTexels && opaque; i++)
+                opaque = rgba[4 * i + 3] == 255;
+            image.format = opaque ? BlockFormat::BC1 : BlockFormat::BC3;
+        }
+
+        std::vector<uint8_t> level(rgba, rgba + size_t(width) * height * 4);
+        while (true) {
+            image.levels.push_back({ width, height, compressLevel(level.data(), width, height, image.format) });
+            if (width == 1 && height == 1)
+                break;
+
+            level = downsample(level.data(), width, height, normalMap);
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+        return image;
+    }
+
+}
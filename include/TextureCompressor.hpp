@@ -0,0 +1,75 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "glad/glad.h"
+
+// EXT_texture_compression_s3tc, not part of the generated GL 3.3 core loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+/**
+ * CPU encoder for the block-compressed texture formats every desktop GPU samples
+ * natively. Each 4x4 block of texels is stored in 8 (BC1) or 16 (BC3, BC5) bytes
+ * instead of 64, and stays compressed in video memory.
+ */
+namespace texcomp {
+
+    enum class BlockFormat : uint32_t {
+        BC1 = 1,        // RGB, 4 bits per texel (DXT1)
+        BC3 = 3,        // RGBA, 8 bits per texel (DXT5)
+        BC5 = 5         // two channels, 8 bits per texel (RGTC2), used for normal maps
+    };
+
+    struct MipLevel {
+        uint32_t width;
+        uint32_t height;
+        std::vector<uint8_t> data;
+    };
+
+    /* A compressed image with its full mip chain, largest level first */
+    struct CompressedImage {
+        BlockFormat format = BlockFormat::BC1;
+        std::vector<MipLevel> levels;
+
+        size_t bytes() const;
+    };
+
+    size_t blockBytes(BlockFormat format);
+    GLenum glInternalFormat(BlockFormat format);
+    const char* formatName(BlockFormat format);
+
+    /* Bytes of an uncompressed texture at 4 bytes per texel, with or without its mip chain */
+    size_t uncompressedBytes(uint32_t width, uint32_t height, bool mipmapped);
+
+    /* Encode one 4x4 block of RGBA texels, given row by row */
+    void encodeBC1(const uint8_t rgba[64], uint8_t out[8]);
+    void encodeBC3(const uint8_t rgba[64], uint8_t out[16]);
+    void encodeBC5(const uint8_t rgba[64], uint8_t out[16]);      // red and green only
+
+    /* Encode an RGBA image; edge blocks of sizes that are not a multiple of 4 repeat the last texels */
+    std::vector<uint8_t> compressLevel(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format);
+
+    /* Next level of a mip chain of an RGBA image: a 2x2 box filter, renormalizing normal maps */
+    std::vector<uint8_t> downsample(const uint8_t* rgba, uint32_t width, uint32_t height, bool normalMap);
+
+    /**
+     * @brief Build the mip chain of an RGBA image down to 1x1 and encode every level.
+     * Normal maps are stored as BC5 and renormalized after each downsample; other images
+     * use BC1, or BC3 if any texel is not opaque.
+     */
+    CompressedImage compress(const uint8_t* rgba, uint32_t width, uint32_t height, bool normalMap);
+
+    /* Whether the driver samples BC1 and BC3 (BC5 is core); needs a current GL context */
+    bool s3tcSupported();
+
+}
+
+#endif // TEXTURE_COMPRESSOR_H
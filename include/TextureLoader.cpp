@@ -0,0 +1,288 @@
+#include "TextureLoader.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+
+#include "stb/stb_image.h"
+
+#include "Profiler.hpp"
+#include "TextureCache.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMs(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+TextureLoader& TextureLoader::instance()
+{
+    static TextureLoader loader;
+    return loader;
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _shutdown = true;
+    }
+    _jobReady.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+
+    for (auto& result : _results)
+        stbi_image_free(result.image.data);
+}
+
+void TextureLoader::startWorkers()
+{
+    // leave one core for the GL thread, which is busy uploading in finish()
+    unsigned int numWorkers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    for (unsigned int i = 0; i < numWorkers; i++)
+        _workers.emplace_back(&TextureLoader::workerLoop, this);
+}
+
+void TextureLoader::setCompression(bool enabled)
+{
+    // RGTC (BC5) is core since GL 3.0, S3TC (BC1, BC3) is an extension every desktop driver has
+    _compressNormals = enabled;
+    _compressColor = enabled && texcomp::s3tcSupported();
+    if (enabled && !_compressColor)
+        std::cout << "TEXTURELOADER::WARNING: S3TC not supported, color textures stay uncompressed" << std::endl;
+}
+
+void TextureLoader::request(const std::string& path, UploadFn upload, int desiredChannels)
+{
+    enqueue({ path, desiredChannels, std::move(upload) });
+}
+
+void TextureLoader::enqueue(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_workers.empty())
+            startWorkers();
+
+        _jobs.push_back(std::move(job));
+        _pending++;
+    }
+    _jobReady.notify_one();
+}
+
+GLuint TextureLoader::requestTexture2D(const std::string& path, TextureKind kind)
+{
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+
+    Job job { path, 0, [textureID](const DecodedImage& image) {
+        if (!image.loaded()) {
+            std::cout << "Texture failed to load at path: " << image.path << std::endl;
+            return;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // the mip chain was built offline, upload it as is
+        if (!image.compressed.levels.empty()) {
+            const auto& levels = image.compressed.levels;
+            GLenum format = texcomp::glInternalFormat(image.compressed.format);
+            for (size_t i = 0; i < levels.size(); i++) {
+                glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), format, levels[i].width, levels[i].height, 0,
+                                       GLsizei(levels[i].data.size()), levels[i].data.data());
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(levels.size() - 1));
+            return;
+        }
+
+        GLenum format;
+        if (image.channels == 1)
+            format = GL_RED;
+        else if (image.channels == 3)
+            format = GL_RGB;
+        else if (image.channels == 4)
+            format = GL_RGBA;
+        else
+            format = GL_RGB;
+
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    } };
+
+    job.mipmapped = true;
+    job.normalMap = kind == TextureKind::Normal;
+    job.compress = job.normalMap ? _compressNormals : _compressColor;
+    enqueue(std::move(job));
+    return textureID;
+}
+
+void TextureLoader::workerLoop()
+{
+    Profiler::instance().setThreadName("texture decode");
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobReady.wait(lock, [this] { return _shutdown || !_jobs.empty(); });
+            if (_shutdown)
+                return;
+
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        Result result;
+        result.image.path = job.path;
+        result.mipmapped = job.mipmapped;
+
+        PROFILE_ZONE("texture decode");
+        auto start = Clock::now();
+        if (job.compress) {
+            decodeCompressed(job, result);
+        } else {
+            result.image.data = stbi_load(job.path.c_str(), &result.image.width, &result.image.height,
+                                          &result.image.channels, job.desiredChannels);
+            if (job.desiredChannels != 0)
+                result.image.channels = job.desiredChannels;
+        }
+        result.decodeMs = elapsedMs(start);
+        result.upload = std::move(job.upload);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _results.push_back(std::move(result));
+        }
+        _resultReady.notify_one();
+    }
+}
+
+void TextureLoader::decodeCompressed(const Job& job, Result& result)
+{
+    DecodedImage& image = result.image;
+    TextureCache cache(job.path, job.normalMap);
+
+    if (cache.load(image.compressed)) {
+        result.cached = true;
+    } else {
+        // first run: decode, build the mip chain and compress it once for every later run
+        unsigned char* pixels = stbi_load(job.path.c_str(), &image.width, &image.height, &image.channels, 4);
+        if (!pixels)
+            return;
+
+        image.compressed = texcomp::compress(pixels, image.width, image.height, job.normalMap);
+        stbi_image_free(pixels);
+        cache.write(image.compressed);
+    }
+
+    image.width = image.compressed.levels[0].width;
+    image.height = image.compressed.levels[0].height;
+    image.channels = image.compressed.format == texcomp::BlockFormat::BC1 ? 3
+                   : image.compressed.format == texcomp::BlockFormat::BC3 ? 4 : 2;
+}
+
+void TextureLoader::finish()
+{
+    auto start = Clock::now();
+
+    while (true) {
+        Result result;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (_pending == 0)
+                break;
+
+            _resultReady.wait(lock, [this] { return !_results.empty(); });
+            result = std::move(_results.front());
+            _results.pop_front();
+        }
+
+        upload(result);
+    }
+
+    _finishWallMs += elapsedMs(start);
+}
+
+size_t TextureLoader::update(double budgetMs)
+{
+    auto start = Clock::now();
+    size_t uploaded = 0;
+
+    // at least one upload per call, so a single large image cannot stall loading
+    while (uploaded == 0 || elapsedMs(start) < budgetMs) {
+        Result result;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_results.empty())
+                break;
+            result = std::move(_results.front());
+            _results.pop_front();
+        }
+
+        upload(result);
+        uploaded++;
+    }
+    return uploaded;
+}
+
+size_t TextureLoader::pending()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _pending;
+}
+
+void TextureLoader::upload(Result& result)
+{
+    double uploadMs;
+    {
+        PROFILE_ZONE("texture upload");
+        auto uploadStart = Clock::now();
+        result.upload(result.image);
+        uploadMs = elapsedMs(uploadStart);
+    }
+    stbi_image_free(result.image.data);
+
+    const DecodedImage& image = result.image;
+    ReportEntry entry { image.path, image.width, image.height, image.channels, "", 0, result.decodeMs, uploadMs };
+    if (!image.compressed.levels.empty()) {
+        entry.format = std::string(texcomp::formatName(image.compressed.format)) + (result.cached ? " cached" : "");
+        entry.gpuBytes = image.compressed.bytes();
+    } else if (image.data) {
+        entry.gpuBytes = texcomp::uncompressedBytes(image.width, image.height, result.mipmapped);
+    }
+    _report.push_back(entry);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending--;
+}
+
+void TextureLoader::printReport(std::ostream& out) const
+{
+    double totalDecode = 0.0, totalUpload = 0.0;
+    size_t totalBytes = 0;
+
+    out << "TEXTURELOADER::REPORT (" << _workers.size() << " decode threads)" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (const auto& entry : _report) {
+        out << "  " << std::setw(9) << entry.decodeMs << " ms decode  "
+            << std::setw(9) << entry.uploadMs << " ms upload  "
+            << entry.width << "x" << entry.height << "x" << entry.channels << "  "
+            << (entry.format.empty() ? "" : entry.format + "  ")
+            << std::setw(8) << entry.gpuBytes / 1024 << " KiB  "
+            << entry.path << std::endl;
+        totalDecode += entry.decodeMs;
+        totalUpload += entry.uploadMs;
+        totalBytes += entry.gpuBytes;
+    }
+    out << "  total: " << totalDecode << " ms decode (summed over threads), "
+        << totalUpload << " ms upload, " << _finishWallMs << " ms waiting in finish(), "
+        << totalBytes / 1024 << " KiB of video memory (uncompressed textures at 4 bytes per texel)" << std::endl;
+    out.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,156 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+
+#include "glad/glad.h"
+
+#include "TextureCompressor.hpp"
+
+/**
+ * Image decoded by a worker thread, waiting to be uploaded on the GL thread.
+ * data is owned by the loader and freed after the upload callback returns.
+ */
+struct DecodedImage {
+    std::string path;
+    unsigned char* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    texcomp::CompressedImage compressed;    // levels replace data for compressed requests
+
+    bool loaded() const {
+        return data || !compressed.levels.empty();
+    }
+};
+
+/* How requestTexture2D() stores an image once compression is enabled */
+enum class TextureKind {
+    Color,      // BC1, or BC3 if any texel is translucent
+    Normal      // BC5: x and y only, the shader rebuilds z
+};
+
+/**
+ * Decodes images on a pool of worker threads while the GL thread only performs
+ * uploads. Requests start decoding as soon as they are queued; texture names are
+ * handed out immediately so callers can keep building meshes/materials while the
+ * pixels are still in flight. Call finish() on the GL thread before rendering, or
+ * update() once per frame to stream textures in (see SceneStreamer).
+ */
+class TextureLoader
+{
+    public:
+        using UploadFn = std::function<void(const DecodedImage&)>;
+
+        static TextureLoader& instance();
+
+        ~TextureLoader();
+
+        /**
+         * @brief Queue an image for decoding. upload() runs on the GL thread from
+         * finish() or update() once the image is decoded (image.data is null if decoding failed).
+         *
+         * @param desiredChannels Passed through to stbi_load, 0 keeps the file's channel count.
+         */
+        void request(const std::string& path, UploadFn upload, int desiredChannels = 0);
+
+        /**
+         * @brief Queue a mipmapped, repeating GL_TEXTURE_2D. The returned texture name is
+         * valid immediately; its storage is filled in by finish() or update().
+         */
+        GLuint requestTexture2D(const std::string& path, TextureKind kind = TextureKind::Color);
+
+        /**
+         * @brief Store textures requested from now on block-compressed, with their mip
+         * chain built and compressed on the worker threads the first time and read back
+         * from a TextureCache afterwards. Must be called on the GL thread; color
+         * textures stay uncompressed if the driver lacks S3TC.
+         */
+        void setCompression(bool enabled);
+
+        /**
+         * @brief Upload decoded images as they complete until every queued request
+         * has been consumed. Must be called on the thread that owns the GL context.
+         */
+        void finish();
+
+        /**
+         * @brief Upload images that finished decoding for up to budgetMs (at least one)
+         * without waiting for the rest. Must be called on the thread that owns the GL context.
+         * @return the number of images uploaded.
+         */
+        size_t update(double budgetMs);
+
+        /* Requests not uploaded yet */
+        size_t pending();
+
+        /**
+         * @brief Print per-file decode/upload times for everything loaded so far.
+         */
+        void printReport(std::ostream& out = std::cout) const;
+
+    private:
+        TextureLoader() = default;
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+
+        void startWorkers();
+        void workerLoop();
+
+        struct Result;
+        void upload(Result& result);
+
+    private:
+        struct Job {
+            std::string path;
+            int desiredChannels;
+            UploadFn upload;
+            bool mipmapped = false;
+            bool compress = false;
+            bool normalMap = false;
+        };
+
+        struct Result {
+            DecodedImage image;
+            UploadFn upload;
+            double decodeMs;
+            bool mipmapped = false;
+            bool cached = false;            // compressed levels read from a TextureCache
+        };
+
+        struct ReportEntry {
+            std::string path;
+            int width, height, channels;
+            std::string format;             // empty if uncompressed
+            size_t gpuBytes;
+            double decodeMs;
+            double uploadMs;
+        };
+
+        void enqueue(Job job);
+        void decodeCompressed(const Job& job, Result& result);
+
+        std::vector<std::thread> _workers;
+        std::deque<Job> _jobs;
+        std::deque<Result> _results;
+        size_t _pending = 0;            // queued or decoding, not yet uploaded
+        bool _shutdown = false;
+        bool _compressColor = false;    // only touched by the GL thread
+        bool _compressNormals = false;
+
+        std::mutex _mutex;
+        std::condition_variable _jobReady;
+        std::condition_variable _resultReady;
+
+        std::vector<ReportEntry> _report;
+        double _finishWallMs = 0.0;
+};
+
+#endif // TEXTURE_LOADER_H
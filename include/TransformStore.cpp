@@ -0,0 +1,222 @@
+#include "TransformStore.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+    /**
+     * The batch math of TransformStore::update(), in place: r0..r5 come in as the
+     * staged cosines and sines, i0..i5 as scale and pivot. Every array is its own
+     * __restrict parameter; GCC does not trust __restrict on locals, and without it
+     * the 21 streams need more runtime alias checks than it will emit, so the loop
+     * would stay scalar.
+     */
+    void compose(size_t n,
+                 float* __restrict r0, float* __restrict r1, float* __restrict r2,
+                 float* __restrict r3, float* __restrict r4, float* __restrict r5,
+                 float* __restrict r6, float* __restrict r7, float* __restrict r8,
+                 float* __restrict i0, float* __restrict i1, float* __restrict i2,
+                 float* __restrict i3, float* __restrict i4, float* __restrict i5,
+                 float* __restrict i6, float* __restrict i7, float* __restrict i8,
+                 float* __restrict t0, float* __restrict t1, float* __restrict t2)
+    {
+        for (size_t k = 0; k < n; k++) {
+            float cx = r0[k], sx = r1[k], cy = r2[k], sy = r3[k], cz = r4[k], sz = r5[k];
+            float scx = i0[k], scy = i1[k], scz = i2[k];
+            float px = i3[k], py = i4[k], pz = i5[k];
+
+            // Rz * Ry * Rx, row-major
+            float q00 = cz * cy, q01 = cz * sy * sx - sz * cx, q02 = cz * sy * cx + sz * sx;
+            float q10 = sz * cy, q11 = sz * sy * sx + cz * cx, q12 = sz * sy * cx - cz * sx;
+            float q20 = -sy,     q21 = cy * sx,                q22 = cy * cx;
+
+            float isx = 1.0f / scx, isy = 1.0f / scy, isz = 1.0f / scz;
+
+            float m00 = q00 * scx, m01 = q01 * scy, m02 = q02 * scz;
+            float m10 = q10 * scx, m11 = q11 * scy, m12 = q12 * scz;
+            float m20 = q20 * scx, m21 = q21 * scy, m22 = q22 * scz;
+            r0[k] = m00; r1[k] = m01; r2[k] = m02;
+            r3[k] = m10; r4[k] = m11; r5[k] = m12;
+            r6[k] = m20; r7[k] = m21; r8[k] = m22;
+
+            i0[k] = q00 * isx; i1[k] = q01 * isy; i2[k] = q02 * isz;
+            i3[k] = q10 * isx; i4[k] = q11 * isy; i5[k] = q12 * isz;
+            i6[k] = q20 * isx; i7[k] = q21 * isy; i8[k] = q22 * isz;
+
+            // translation + (R * S) * pivot
+            t0[k] += m00 * px + m01 * py + m02 * pz;
+            t1[k] += m10 * px + m11 * py + m12 * pz;
+            t2[k] += m20 * px + m21 * py + m22 * pz;
+        }
+    }
+}
+
+TransformStore& TransformStore::instance()
+{
+    static TransformStore store;
+    return store;
+}
+
+uint32_t TransformStore::create(const glm::vec3& pivot)
+{
+    uint32_t slot;
+    if (!_free.empty()) {
+        slot = _free.back();
+        _free.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(_uniforms.size());
+        for (auto* v : { &_tx, &_ty, &_tz, &_rx, &_ry, &_rz, &_sx, &_sy, &_sz, &_px, &_py, &_pz,
+                         &_cx, &_cy, &_cz, &_snx, &_sny, &_snz })
+            v->push_back(0.0f);
+        _dirty.push_back(0);
+        _uniforms.emplace_back();
+    }
+
+    _tx[slot] = _ty[slot] = _tz[slot] = 0.0f;
+    _rx[slot] = _ry[slot] = _rz[slot] = 0.0f;
+    _sx[slot] = _sy[slot] = _sz[slot] = 1.0f;
+    _px[slot] = pivot.x;
+    _py[slot] = pivot.y;
+    _pz[slot] = pivot.z;
+    _cx[slot] = _cy[slot] = _cz[slot] = 1.0f;
+    _snx[slot] = _sny[slot] = _snz[slot] = 0.0f;
+    _uniforms[slot] = ObjectUniforms();
+    markDirty(slot);
+    return slot;
+}
+
+uint32_t TransformStore::clone(uint32_t src)
+{
+    if (src == InvalidSlot)
+        return create();
+
+    // copy before create() may reallocate the arrays
+    glm::vec3 t(_tx[src], _ty[src], _tz[src]);
+    glm::vec3 r(_rx[src], _ry[src], _rz[src]);
+    glm::vec3 s(_sx[src], _sy[src], _sz[src]);
+    glm::vec3 p(_px[src], _py[src], _pz[src]);
+    ObjectUniforms uniforms = _uniforms[src];
+
+    uint32_t slot = create(p);
+    _tx[slot] = t.x; _ty[slot] = t.y; _tz[slot] = t.z;
+    _rx[slot] = r.x; _ry[slot] = r.y; _rz[slot] = r.z;
+    _sx[slot] = s.x; _sy[slot] = s.y; _sz[slot] = s.z;
+    _uniforms[slot] = uniforms;
+    markDirty(slot, RotationDirty);
+    return slot;
+}
+
+void TransformStore::destroy(uint32_t slot)
+{
+    // a freed slot may still sit in the dirty list; recomputing it is harmless
+    _free.push_back(slot);
+}
+
+void TransformStore::translate(uint32_t slot, const glm::vec3& t)
+{
+    _tx[slot] += t.x;
+    _ty[slot] += t.y;
+    _tz[slot] += t.z;
+    markDirty(slot);
+}
+
+void TransformStore::rotate(uint32_t slot, const glm::vec3& degrees)
+{
+    _rx[slot] += degrees.x;
+    _ry[slot] += degrees.y;
+    _rz[slot] += degrees.z;
+    markDirty(slot, RotationDirty);
+}
+
+void TransformStore::scale(uint32_t slot, const glm::vec3& s)
+{
+    _sx[slot] *= s.x;
+    _sy[slot] *= s.y;
+    _sz[slot] *= s.z;
+    markDirty(slot);
+}
+
+/**
+ * @brief Builds model = T * Rz * Ry * Rx * S * T(pivot) for all dirty slots.
+ *
+ * The inverse transpose of the upper 3x3 is R * S^-1, so no general matrix inverse is
+ * needed. The math runs over flat float arrays with no branches or aliasing so the
+ * compiler vectorises it; gathering from and scattering to the slots is kept in
+ * separate loops.
+ */
+size_t TransformStore::update()
+{
+    const size_t n = _dirtyList.size();
+    _lastMotion = 0.0f;
+    if (n == 0)
+        return 0;
+
+    for (auto& v : _batch.r) v.resize(n);
+    for (auto& v : _batch.i) v.resize(n);
+    for (auto& v : _batch.t) v.resize(n);
+
+    // refresh the cached sines and cosines of rotated slots only; moving or scaling
+    // an object does not pay for the trigonometry
+    const float toRadians = 3.14159265358979f / 180.0f;
+    for (uint32_t slot : _dirtyList) {
+        if (!(_dirty[slot] & RotationDirty))
+            continue;
+        float ax = _rx[slot] * toRadians, ay = _ry[slot] * toRadians, az = _rz[slot] * toRadians;
+        _cx[slot] = std::cos(ax);
+        _snx[slot] = std::sin(ax);
+        _cy[slot] = std::cos(ay);
+        _sny[slot] = std::sin(ay);
+        _cz[slot] = std::cos(az);
+        _snz[slot] = std::sin(az);
+    }
+
+    // gather the dirty slots into the batch so the loop below is pure arithmetic
+    std::vector<float>* r = _batch.r;
+    std::vector<float>* inv = _batch.i;
+    std::vector<float>* t = _batch.t;
+    for (size_t k = 0; k < n; k++) {
+        uint32_t slot = _dirtyList[k];
+        r[0][k] = _cx[slot];       // staged: cx, sx, cy, sy, cz, sz
+        r[1][k] = _snx[slot];
+        r[2][k] = _cy[slot];
+        r[3][k] = _sny[slot];
+        r[4][k] = _cz[slot];
+        r[5][k] = _snz[slot];
+        inv[0][k] = _sx[slot];     // staged: scale, pivot
+        inv[1][k] = _sy[slot];
+        inv[2][k] = _sz[slot];
+        inv[3][k] = _px[slot];
+        inv[4][k] = _py[slot];
+        inv[5][k] = _pz[slot];
+        t[0][k] = _tx[slot];
+        t[1][k] = _ty[slot];
+        t[2][k] = _tz[slot];
+    }
+
+    compose(n, r[0].data(), r[1].data(), r[2].data(), r[3].data(), r[4].data(), r[5].data(),
+            r[6].data(), r[7].data(), r[8].data(),
+            inv[0].data(), inv[1].data(), inv[2].data(), inv[3].data(), inv[4].data(), inv[5].data(),
+            inv[6].data(), inv[7].data(), inv[8].data(),
+            t[0].data(), t[1].data(), t[2].data());
+
+    // scatter into the column-major uniform matrices
+    for (size_t k = 0; k < n; k++) {
+        uint32_t slot = _dirtyList[k];
+        ObjectUniforms& u = _uniforms[slot];
+        glm::mat4 previous = u.model;
+        float basisMotion = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            u.model[c] = glm::vec4(r[c][k], r[3 + c][k], r[6 + c][k], 0.0f);
+            u.invTransposeModel[c] = glm::vec4(inv[c][k], inv[3 + c][k], inv[6 + c][k], 0.0f);
+            basisMotion = std::max(basisMotion, glm::length(u.model[c] - previous[c]));
+        }
+        u.model[3] = glm::vec4(t[0][k], t[1][k], t[2][k], 1.0f);
+        _lastMotion = std::max(_lastMotion, glm::length(u.model[3] - previous[3]) + basisMotion);
+        u.invTransposeModel[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        _dirty[slot] = 0;
+    }
+
+    _dirtyList.clear();
+    return n;
+}
@@ -0,0 +1,161 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+#include "RenderQueue.hpp"
+
+/**
+ * Translation, rotation and scale of every Entity/PointLight kept as a structure of
+ * arrays, together with the cached ObjectUniforms built from them. Setters only mark
+ * the slot dirty; update() recomputes the world and inverse transpose matrices of all
+ * dirty slots in one batch, so static objects cost nothing after their first frame.
+ *
+ * Must only be used from the thread that owns the GL context.
+ */
+class TransformStore
+{
+    public:
+        static constexpr uint32_t InvalidSlot = UINT32_MAX;
+
+        static TransformStore& instance();
+
+        /* New identity transform; pivot is applied before scale and rotation (e.g. -centroid) */
+        uint32_t create(const glm::vec3& pivot = glm::vec3(0.0f));
+        uint32_t clone(uint32_t slot);
+        void destroy(uint32_t slot);
+
+        void translate(uint32_t slot, const glm::vec3& t);
+        void rotate(uint32_t slot, const glm::vec3& degrees);
+        void scale(uint32_t slot, const glm::vec3& s);
+
+        glm::vec3 translation(uint32_t slot) const {
+            return glm::vec3(_tx[slot], _ty[slot], _tz[slot]);
+        }
+
+        /* Cached uniforms; the matrices are only valid after update() */
+        ObjectUniforms& uniforms(uint32_t slot) {
+            return _uniforms[slot];
+        }
+
+        const ObjectUniforms& uniforms(uint32_t slot) const {
+            return _uniforms[slot];
+        }
+
+        /**
+         * @brief Recompute every slot changed since the last call. Call once per frame
+         * before any draw; returns the number of slots updated.
+         */
+        size_t update();
+
+        /**
+         * @brief How far any object moved in the last update(): the largest change of a
+         * translation plus the largest change of a basis vector, i.e. exact for points
+         * within unit distance of an object's pivot in model space.
+         */
+        float lastMotion() const {
+            return _lastMotion;
+        }
+
+        size_t size() const {
+            return _uniforms.size() - _free.size();
+        }
+
+    private:
+        TransformStore() = default;
+        TransformStore(const TransformStore&) = delete;
+        TransformStore& operator=(const TransformStore&) = delete;
+
+        enum DirtyBits : uint8_t {
+            MatrixDirty = 1 << 0,
+            RotationDirty = 1 << 1     // cached sines and cosines are stale
+        };
+
+        void markDirty(uint32_t slot, uint8_t bits = MatrixDirty) {
+            if (!_dirty[slot])
+                _dirtyList.push_back(slot);
+            _dirty[slot] |= bits | MatrixDirty;
+        }
+
+    private:
+        // per slot, SoA so the batch update streams through contiguous floats
+        std::vector<float> _tx, _ty, _tz;
+        std::vector<float> _rx, _ry, _rz;   // degrees
+        std::vector<float> _sx, _sy, _sz;
+        std::vector<float> _px, _py, _pz;   // pivot
+        std::vector<float> _cx, _cy, _cz;   // cos/sin of the rotation angles, refreshed
+        std::vector<float> _snx, _sny, _snz;  // only when the rotation changes
+        std::vector<uint8_t> _dirty;
+        std::vector<ObjectUniforms> _uniforms;
+
+        std::vector<uint32_t> _dirtyList;
+        std::vector<uint32_t> _free;
+        float _lastMotion = 0.0f;
+
+        // scratch for the batch update, one entry per dirty slot
+        struct Batch {
+            std::vector<float> r[9];    // rotation * scale, row-major
+            std::vector<float> i[9];    // rotation * inverse scale, row-major
+            std::vector<float> t[3];    // translation including the pivot
+        } _batch;
+};
+
+/**
+ * Owning handle to a TransformStore slot. Copies get their own slot with the same
+ * transform, so objects holding one keep value semantics.
+ */
+class Transform
+{
+    public:
+        explicit Transform(const glm::vec3& pivot = glm::vec3(0.0f))
+            : _slot(TransformStore::instance().create(pivot)) {}
+
+        Transform(const Transform& o)
+            : _slot(TransformStore::instance().clone(o._slot)) {}
+
+        Transform(Transform&& o) noexcept : _slot(o._slot) {
+            o._slot = TransformStore::InvalidSlot;
+        }
+
+        Transform& operator=(Transform o) noexcept {
+            std::swap(_slot, o._slot);
+            return *this;
+        }
+
+        ~Transform() {
+            if (_slot != TransformStore::InvalidSlot)
+                TransformStore::instance().destroy(_slot);
+        }
+
+        void translate(const glm::vec3& t) {
+            TransformStore::instance().translate(_slot, t);
+        }
+
+        void rotate(const glm::vec3& degrees) {
+            TransformStore::instance().rotate(_slot, degrees);
+        }
+
+        void scale(const glm::vec3& s) {
+            TransformStore::instance().scale(_slot, s);
+        }
+
+        glm::vec3 translation() const {
+            return TransformStore::instance().translation(_slot);
+        }
+
+        ObjectUniforms& uniforms() {
+            return TransformStore::instance().uniforms(_slot);
+        }
+
+        const ObjectUniforms& uniforms() const {
+            return TransformStore::instance().uniforms(_slot);
+        }
+
+    private:
+        uint32_t _slot;
+};
+
+#endif // TRANSFORM_STORE_H
@@ -0,0 +1,188 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#include "glad/glad.h"
+#include "glm/glm.hpp"
+
+#include "LightSource/LightSource.hpp"
+
+/**
+ * std140 uniform blocks shared by every shader program. GLSL 3.3/4.1 cannot declare
+ * the binding point in the shader, so Shader::bindUniformBlock() maps the block
+ * names below onto these binding points after linking.
+ */
+namespace ubo {
+
+    enum Binding : GLuint {
+        CameraBinding = 0,
+        LightsBinding = 1
+    };
+
+    constexpr const char* CameraBlockName = "Camera";
+    constexpr const char* LightsBlockName = "Lights";
+
+    // must match MAX_NUM_POINT_LIGHTS / MAX_NUM_DIR_LIGHTS in Entity/shader.frag
+    constexpr int MaxPointLights = 4;
+    constexpr int MaxDirLights = 1;
+
+    // layout (std140) uniform Camera
+    struct CameraBlock {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::vec4 viewPos;          // xyz = camera position in world space
+    };
+
+    // each vec3 is packed with the following float into one std140 vec4 slot
+    struct PointLightStd140 {
+        glm::vec3 position;   float kConstant;
+        glm::vec3 ambient;    float kLinear;
+        glm::vec3 diffuse;    float kQuadratic;
+        glm::vec3 specular;   float pad;
+    };
+
+    struct DirLightStd140 {
+        glm::vec3 direction;  float pad0;
+        glm::vec3 ambient;    float pad1;
+        glm::vec3 diffuse;    float pad2;
+        glm::vec3 specular;   float pad3;
+    };
+
+    // layout (std140) uniform Lights
+    struct LightsBlock {
+        PointLightStd140 pointLights[MaxPointLights];
+        DirLightStd140 dirLights[MaxDirLights];
+        int numPointLights;
+        int numDirLights;
+        int pad[2];
+    };
+
+    static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match std140 layout");
+    static_assert(sizeof(PointLightStd140) == 64, "PointLightStd140 must match std140 layout");
+    static_assert(sizeof(DirLightStd140) == 64, "DirLightStd140 must match std140 layout");
+}
+
+/**
+ * One std140 Camera block per render pass, stored back to back in a single buffer
+ * (each slot padded to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT). All slots are uploaded
+ * once per frame; selecting a pass's camera is a single glBindBufferRange.
+ */
+class CameraUniformBuffer
+{
+    public:
+        CameraUniformBuffer() {
+            glGenBuffers(1, &_ubo);
+
+            GLint alignment = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            _slotSize = (sizeof(ubo::CameraBlock) + alignment - 1) / alignment * alignment;
+        }
+
+        ~CameraUniformBuffer() {
+            glDeleteBuffers(1, &_ubo);
+        }
+
+        CameraUniformBuffer(const CameraUniformBuffer&) = delete;
+        CameraUniformBuffer& operator=(const CameraUniformBuffer&) = delete;
+
+        void setSlot(size_t slot, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos) {
+            if (_staging.size() < (slot + 1) * _slotSize)
+                _staging.resize((slot + 1) * _slotSize);
+
+            ubo::CameraBlock block = { view, projection, glm::vec4(viewPos, 1.0f) };
+            std::memcpy(_staging.data() + slot * _slotSize, &block, sizeof(block));
+        }
+
+        /* Upload every slot set since the last upload in one call */
+        void upload() {
+            glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+            if (_staging.size() > _capacity) {
+                _capacity = _staging.size();
+                glBufferData(GL_UNIFORM_BUFFER, _capacity, _staging.data(), GL_DYNAMIC_DRAW);
+            } else {
+                glBufferSubData(GL_UNIFORM_BUFFER, 0, _staging.size(), _staging.data());
+            }
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        void bind(size_t slot) const {
+            glBindBufferRange(GL_UNIFORM_BUFFER, ubo::CameraBinding, _ubo, slot * _slotSize, sizeof(ubo::CameraBlock));
+        }
+
+    private:
+        GLuint _ubo;
+        size_t _slotSize;
+        size_t _capacity = 0;
+        std::vector<unsigned char> _staging;
+};
+
+/**
+ * Point and directional light arrays in a single std140 Lights block, bound once
+ * for the lifetime of the scene. Moving a light re-uploads only that light's slot.
+ */
+class LightUniformBuffer
+{
+    public:
+        LightUniformBuffer() {
+            glGenBuffers(1, &_ubo);
+            glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(ubo::LightsBlock), nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glBindBufferBase(GL_UNIFORM_BUFFER, ubo::LightsBinding, _ubo);
+            _block = {};
+        }
+
+        ~LightUniformBuffer() {
+            glDeleteBuffers(1, &_ubo);
+        }
+
+        LightUniformBuffer(const LightUniformBuffer&) = delete;
+        LightUniformBuffer& operator=(const LightUniformBuffer&) = delete;
+
+        /* Upload the whole block */
+        void set(const std::vector<PointLight>& pointLights, const std::vector<DirLight>& dirLights) {
+            _block.numPointLights = std::min<int>(pointLights.size(), ubo::MaxPointLights);
+            _block.numDirLights = std::min<int>(dirLights.size(), ubo::MaxDirLights);
+
+            for (int i = 0; i < _block.numPointLights; i++)
+                _block.pointLights[i] = pack(pointLights[i]);
+
+            for (int i = 0; i < _block.numDirLights; i++) {
+                const DirLight& dl = dirLights[i];
+                _block.dirLights[i] = { dl._direction, 0.0f, dl._ambient, 0.0f, dl._diffuse, 0.0f, dl._specular, 0.0f };
+            }
+
+            glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(_block), &_block);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+        /* Re-upload a single point light, e.g. after it moved */
+        void updatePointLight(int index, const PointLight& pl) {
+            if (index < 0 || index >= _block.numPointLights)
+                return;
+
+            _block.pointLights[index] = pack(pl);
+
+            glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+            glBufferSubData(GL_UNIFORM_BUFFER, offsetof(ubo::LightsBlock, pointLights) + index * sizeof(ubo::PointLightStd140),
+                            sizeof(ubo::PointLightStd140), &_block.pointLights[index]);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+
+    private:
+        static ubo::PointLightStd140 pack(const PointLight& pl) {
+            return { pl.position(), pl.kConstant(), pl.ambient(), pl.kLinear(),
+                     pl.diffuse(), pl.kQuadratic(), pl.specular(), 0.0f };
+        }
+
+    private:
+        GLuint _ubo;
+        ubo::LightsBlock _block;
+};
+
+#endif // UNIFORM_BLOCKS_H
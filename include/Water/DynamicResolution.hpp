@@ -0,0 +1,74 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <cmath>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+/**
+ * Picks the resolution of the water reflection/refraction targets. A global budget
+ * scale follows the frame time: it shrinks while smoothed frames run over budget and
+ * slowly recovers while they are comfortably under it. Each water is then scaled down
+ * further by its screen coverage, since a small patch of water on screen does not
+ * need full resolution reflections.
+ *
+ * Scales are quantized so the targets are only reallocated on noticeable changes.
+ */
+class DynamicResolution
+{
+    public:
+        DynamicResolution(float frameBudgetMs = 1000.0f / 60.0f, float minScale = 0.25f, float maxScale = 1.0f)
+            : _frameBudgetMs(frameBudgetMs), _minScale(minScale), _maxScale(maxScale), _budgetScale(maxScale) {}
+
+        void setFrameBudget(float ms) {
+            _frameBudgetMs = ms;
+        }
+
+        float frameBudget() const {
+            return _frameBudgetMs;
+        }
+
+        /* Feed the duration of the previous frame; call once per frame */
+        void update(float frameMs) {
+            // ignore stalls such as scene loading, they say nothing about rendering cost
+            if (frameMs <= 0.0f || frameMs > 1000.0f)
+                return;
+
+            _smoothedMs = _smoothedMs < 0.0f ? frameMs : glm::mix(_smoothedMs, frameMs, 0.1f);
+
+            // hysteresis band, so a frame time close to the budget does not oscillate
+            if (_smoothedMs > 1.05f * _frameBudgetMs)
+                _budgetScale *= 0.95f;
+            else if (_smoothedMs < 0.85f * _frameBudgetMs)
+                _budgetScale *= 1.01f;
+            _budgetScale = glm::clamp(_budgetScale, _minScale, _maxScale);
+        }
+
+        /* Scale driven by the frame time alone */
+        float budgetScale() const {
+            return _budgetScale;
+        }
+
+        /**
+         * @brief Resolution scale for one water target.
+         *
+         * @param coverage Fraction of the screen covered by the water, in [0, 1]. Water
+         * covering a quarter of the screen or more gets the full budget scale.
+         */
+        float scale(float coverage) const {
+            float coverageScale = std::min(2.0f * std::sqrt(std::max(coverage, 0.0f)), 1.0f);
+            float s = glm::clamp(_budgetScale * coverageScale, _minScale, _maxScale);
+            return std::round(s / Step) * Step;
+        }
+
+    private:
+        static constexpr float Step = 0.0625f;
+
+        float _frameBudgetMs;
+        float _minScale, _maxScale;
+        float _budgetScale;
+        float _smoothedMs = -1.0f;
+};
+
+#endif // DYNAMIC_RESOLUTION_H
@@ -2,16 +2,18 @@
 #define WATER_H
 
 #include <vector>
+#include <memory>
 #include <algorithm>
-#include <chrono>
+#include <cmath>
 
 #include "glad/glad.h"
 #include "glm/glm.hpp"
-#include "GLFW/glfw3.h"
+#include "Surface.hpp"
 
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "Water/WaterFrameBuffer.hpp"
+#include "TextureLoader.hpp"
 
 class Water
 {
@@ -21,15 +23,34 @@ class Water
          * Water is represented as a quad located at "center". Its extent is parameterized by
          * dx and dy. The four corners of the quad are computed as center +/- dx +/- dy.
          */
-        Water(GLFWwindow* window, const glm::vec3& center, const glm::vec3& dx, const glm::vec3& dy);
+        Water(const Surface* surface, const glm::vec3& center, const glm::vec3& dx, const glm::vec3& dy);
         ~Water();
 
-        void draw(Shader* shader, const Camera* camera, const int viewportWidth, const int viewportHeight);
+        // owns GL objects: movable (so it can live in a std::vector), not copyable
+        Water(Water&& o) noexcept;
+        Water(const Water&) = delete;
+        Water& operator=(const Water&) = delete;
+
+        /**
+         * @brief Draw the water quad. Expects the main camera's Camera uniform block to be bound.
+         *
+         * @param time Seconds the application has been running, drives the waves.
+         */
+        void draw(Shader* shader, const Camera* camera, float time);
 
         WaterFrameBuffer* getWaterFrameBuffer() {
+            return _waterFrameBuffer.get();
+        }
+
+        const std::shared_ptr<WaterFrameBuffer>& sharedWaterFrameBuffer() const {
             return _waterFrameBuffer;
         }
 
+        /* Render from and sample another water's targets, e.g. one on the same plane */
+        void setWaterFrameBuffer(const std::shared_ptr<WaterFrameBuffer>& fbo) {
+            _waterFrameBuffer = fbo;
+        }
+
         glm::vec3 getNormal() const {
             glm::vec3 normal = glm::normalize(glm::cross(_dx, _dy));
             return normal;
@@ -51,6 +72,15 @@ class Water
             _waveDirection = v;
         }
 
+        /**
+         * @brief The water quad clipped to the view volume, in normalized device
+         * coordinates. Empty if the quad is off screen.
+         */
+        std::vector<glm::vec2> screenFootprint(const glm::mat4& viewProjection) const;
+
+        /* Fraction of the screen covered by the water quad, in [0, 1] */
+        float screenCoverage(const glm::mat4& viewProjection) const;
+
     private:
         GLuint initWaterVAO();
         Shader* initWaterShader();
@@ -61,15 +91,14 @@ class Water
         glm::vec3 _dx;
         glm::vec3 _dy;
 
-        std::chrono::time_point<std::chrono::high_resolution_clock> _timeAtCtor;    // a higher level class should manage this in the future
         GLuint _waterVAO, _waterVBO, _waterEBO;
         GLuint _waterDuDvMap;
-        GLuint _waterNormalMap;
+        GLuint _waterNormalMap = 0;
         
         const std::string _dudvMapPath = "../include/Water/dudv.png";
         const std::string _normalMapPath = "../include/Water/normals.png";
 
-        WaterFrameBuffer* _waterFrameBuffer;
+        std::shared_ptr<WaterFrameBuffer> _waterFrameBuffer;   // may be shared by coplanar waters
 
         const float _refractiveIndex = 1.33f;
         glm::vec2 _waveDirection;
@@ -78,26 +107,36 @@ class Water
 
 };
 
-Water::Water(GLFWwindow* window, const glm::vec3& center, const glm::vec3& dx, const glm::vec3& dy)
+inline Water::Water(const Surface* surface, const glm::vec3& center, const glm::vec3& dx, const glm::vec3& dy)
     : _center(center), _dx(dx), _dy(dy)
 {
-    _waterFrameBuffer = new WaterFrameBuffer(window);
+    _waterFrameBuffer = std::make_shared<WaterFrameBuffer>(surface);
     _waterVAO = initWaterVAO();
     _waterDuDvMap = initWaterDuDvMap();
     setWaveDirection(glm::vec2(0.0f, -1.0f));
-    _timeAtCtor = std::chrono::high_resolution_clock::now();
 }
 
-Water::~Water()
+inline Water::Water(Water&& o) noexcept
+    : _center(o._center), _dx(o._dx), _dy(o._dy),
+      _waterVAO(o._waterVAO), _waterVBO(o._waterVBO), _waterEBO(o._waterEBO),
+      _waterDuDvMap(o._waterDuDvMap), _waterNormalMap(o._waterNormalMap),
+      _waterFrameBuffer(std::move(o._waterFrameBuffer)),
+      _waveDirection(o._waveDirection), _waveSpeed(o._waveSpeed), _waveMoveFactor(o._waveMoveFactor)
+{
+    // deleting name 0 is a no-op, so the moved-from destructor releases nothing
+    o._waterVAO = o._waterVBO = o._waterEBO = 0;
+    o._waterDuDvMap = o._waterNormalMap = 0;
+}
+
+inline Water::~Water()
 {
-    delete _waterFrameBuffer;
     glDeleteBuffers(1, &_waterVBO);
     glDeleteBuffers(1, &_waterEBO);
     glDeleteTextures(1, &_waterDuDvMap);
     glDeleteVertexArrays(1, &_waterVAO);
 }
 
-GLuint Water::initWaterVAO()
+inline GLuint Water::initWaterVAO()
 {
     // define quad vertices
     const int numVertices = 4, floatsPerVertex = 3;
@@ -139,7 +178,7 @@ GLuint Water::initWaterVAO()
     return VAO;
 }
 
-GLuint Water::initWaterDuDvMap()
+inline GLuint Water::initWaterDuDvMap()
 {
     GLuint texture;
     glGenTextures(1, &texture);
@@ -149,35 +188,90 @@ GLuint Water::initWaterDuDvMap()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    int width, height, numChannels;
-    unsigned char* data = stbi_load(_dudvMapPath.c_str(), &width, &height, &numChannels, 0);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    } else {
-        std::cout << "Water::initWaterDuDvMap::ERROR: Failed to load image." << std::endl;
-    }
-    stbi_image_free(data);
+    TextureLoader::instance().request(_dudvMapPath, [texture](const DecodedImage& image) {
+        if (image.data) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
+        } else {
+            std::cout << "Water::initWaterDuDvMap::ERROR: Failed to load image." << std::endl;
+        }
+    }, 3);
 
     return texture;
 }
 
-void Water::draw(Shader* shader, const Camera* camera, const int viewportWidth, const int viewportHeight)
+inline std::vector<glm::vec2> Water::screenFootprint(const glm::mat4& viewProjection) const
+{
+    std::vector<glm::vec4> polygon = {
+        viewProjection * glm::vec4(_center - _dx - _dy, 1.0f),
+        viewProjection * glm::vec4(_center + _dx - _dy, 1.0f),
+        viewProjection * glm::vec4(_center + _dx + _dy, 1.0f),
+        viewProjection * glm::vec4(_center - _dx + _dy, 1.0f)
+    };
+
+    // clip against the near, left, right, bottom and top planes in clip space, so
+    // corners behind the camera do not flip across the screen
+    const glm::vec4 planes[] = {
+        glm::vec4( 0.0f,  0.0f, 1.0f, 1.0f),
+        glm::vec4( 1.0f,  0.0f, 0.0f, 1.0f),
+        glm::vec4(-1.0f,  0.0f, 0.0f, 1.0f),
+        glm::vec4( 0.0f,  1.0f, 0.0f, 1.0f),
+        glm::vec4( 0.0f, -1.0f, 0.0f, 1.0f)
+    };
+
+    std::vector<glm::vec4> clipped;
+    for (const auto& plane : planes) {
+        clipped.clear();
+        for (size_t i = 0; i < polygon.size(); i++) {
+            const glm::vec4& a = polygon[i];
+            const glm::vec4& b = polygon[(i + 1) % polygon.size()];
+            float da = glm::dot(a, plane), db = glm::dot(b, plane);
+            if (da >= 0.0f)
+                clipped.push_back(a);
+            if ((da >= 0.0f) != (db >= 0.0f))
+                clipped.push_back(a + (b - a) * (da / (da - db)));
+        }
+        polygon.swap(clipped);
+    }
+
+    std::vector<glm::vec2> footprint;
+    for (const auto& p : polygon) {
+        footprint.push_back(glm::vec2(p) / p.w);
+    }
+    return footprint;
+}
+
+inline float Water::screenCoverage(const glm::mat4& viewProjection) const
+{
+    std::vector<glm::vec2> footprint = screenFootprint(viewProjection);
+
+    float area = 0.0f;
+    for (size_t i = 0; i < footprint.size(); i++) {
+        const glm::vec2& a = footprint[i];
+        const glm::vec2& b = footprint[(i + 1) % footprint.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+
+    // normalized device coordinates span an area of 4
+    return std::min(std::abs(area) * 0.5f / 4.0f, 1.0f);
+}
+
+inline void Water::draw(Shader* shader, const Camera* camera, float time)
 {
     glBindVertexArray(_waterVAO);
     shader->use();
 
-    glm::mat4 view = camera->lookAt(); 
-    glm::mat4 projection = glm::perspective(glm::radians(camera->getFov()), (float)(viewportWidth) / viewportHeight, 0.1f, 100.0f); 
-    shader->setFloat("nearPlane", 0.1f);
-    shader->setFloat("farPlane", 100.0f);
+    shader->setFloat("nearPlane"_u, 0.1f);
+    shader->setFloat("farPlane"_u, 100.0f);
 
-    shader->setMat4("view", view);
-    shader->setMat4("projection", projection);
+    shader->setInt("reflectionTexture"_u, 0);
+    shader->setInt("refractionTexture"_u, 1);
+    shader->setInt("dudvMap"_u, 2);
+    shader->setInt("depthTexture"_u, 3);
 
-    shader->setInt("reflectionTexture", 0);
-    shader->setInt("refractionTexture", 1);
-    shader->setInt("dudvMap", 2);
-    shader->setInt("depthTexture", 3);
+    // the textures may be from an earlier frame; sample them where the surface was then
+    shader->setMat4("reflectionViewProjection"_u, _waterFrameBuffer->reflectionViewProjection());
+    shader->setMat4("refractionViewProjection"_u, _waterFrameBuffer->refractionViewProjection());
 
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, _waterFrameBuffer->getReflectionColorTexture());
@@ -191,15 +285,14 @@ void Water::draw(Shader* shader, const Camera* camera, const int viewportWidth,
     // compute fresnel factor using Schlick's approximation
     float R0 = (1 - _refractiveIndex) / (1 + _refractiveIndex) * (1 - _refractiveIndex) / (1 + _refractiveIndex);
     float R = R0 + (1 - R0) * (1 - std::max(glm::dot(-camera->getFront(), this->getNormal()), 0.0f));
-    shader->setFloat("fresnelFactor", 1);
+    shader->setFloat("fresnelFactor"_u, 1);
 
     // update wave velocity and time uniforms
-    auto currTime = std::chrono::high_resolution_clock::now();
-    float sec = std::chrono::duration_cast<std::chrono::seconds>(currTime - _timeAtCtor).count() / 1000.0f;
+    float sec = std::floor(time) / 1000.0f;
     _waveMoveFactor += _waveSpeed * sec;
     float moveFactorFractionalPart = _waveMoveFactor - (int)(_waveMoveFactor);
-    shader->setFloat("waveMoveFactor", moveFactorFractionalPart);
-    shader->setVec2("waveDir", _waveDirection);
+    shader->setFloat("waveMoveFactor"_u, moveFactorFractionalPart);
+    shader->setVec2("waveDir"_u, _waveDirection);
 
     // draw call
     glEnable(GL_BLEND);
@@ -1,28 +1,62 @@
 #ifndef WATER_FBO_H
 #define WATER_FBO_H
 
+#include <algorithm>
+
 #include "glad/glad.h"
-#include "GLFW/glfw3.h"
+#include "glm/glm.hpp"
+
+#include "Surface.hpp"
 
 class WaterFrameBuffer
 {
     public:
-        WaterFrameBuffer(GLFWwindow* window);
+        WaterFrameBuffer(const Surface* surface);
         ~WaterFrameBuffer();
 
         void bindReflectionFrameBuffer();
         void bindRefractionFrameBuffer();
-        void unbindReflectionFrameBuffer(GLFWwindow* window);
-        void unbindRefractionFrameBuffer(GLFWwindow* window);
+        void unbindReflectionFrameBuffer(const Surface* surface);
+        void unbindRefractionFrameBuffer(const Surface* surface);
 
         GLuint getReflectionColorTexture() const;
         GLuint getRefractionColorTexture() const;
         GLuint getRefractionDepthTexture() const;
 
+        /**
+         * @brief Reallocate the reflection and refraction targets; no-op if the size is unchanged.
+         * @return true if the targets were reallocated and their contents lost.
+         */
+        bool resize(int width, int height);
+
+        /* View-projection the textures were last rendered with, used to reproject them */
+        const glm::mat4& reflectionViewProjection() const {
+            return _reflectionViewProjection;
+        }
+
+        const glm::mat4& refractionViewProjection() const {
+            return _refractionViewProjection;
+        }
+
+        void setReflectionViewProjection(const glm::mat4& m) {
+            _reflectionViewProjection = m;
+        }
+
+        void setRefractionViewProjection(const glm::mat4& m) {
+            _refractionViewProjection = m;
+        }
+
+        int width() const {
+            return reflectionBufferWidth;
+        }
+
+        int height() const {
+            return reflectionBufferHeight;
+        }
 
     private:
-        void initReflectionFrameBuffer(GLFWwindow* window);
-        void initRefractionFrameBuffer(GLFWwindow* window);
+        void initReflectionFrameBuffer(const Surface* surface);
+        void initRefractionFrameBuffer(const Surface* surface);
         GLuint createColorTextureAttachment(int width, int height);
         GLuint createDepthTextureAttachment(int width, int height);
         GLuint createDepthBufferAttachment(int width, int height);
@@ -42,40 +76,42 @@ class WaterFrameBuffer
         GLuint refractionDepthTexture;
         unsigned int refractionBufferWidth = 640;
         unsigned int refractionBufferHeight = 480;
-        
+
+        glm::mat4 _reflectionViewProjection = glm::mat4(1.0f);
+        glm::mat4 _refractionViewProjection = glm::mat4(1.0f);
 };
 
-WaterFrameBuffer::WaterFrameBuffer(GLFWwindow* window)
+inline WaterFrameBuffer::WaterFrameBuffer(const Surface* surface)
 {
-    initReflectionFrameBuffer(window);
-    initRefractionFrameBuffer(window);
+    initReflectionFrameBuffer(surface);
+    initRefractionFrameBuffer(surface);
 }
 
-WaterFrameBuffer::~WaterFrameBuffer()
+inline WaterFrameBuffer::~WaterFrameBuffer()
 {
     destroyReflectionFrameBuffer();
     destroyRefractionFrameBuffer();
 }
 
-void WaterFrameBuffer::initReflectionFrameBuffer(GLFWwindow* window)
+inline void WaterFrameBuffer::initReflectionFrameBuffer(const Surface* surface)
 {
     glGenFramebuffers(1, &reflectionFrameBuffer);
     bindReflectionFrameBuffer();
     reflectionColorTexture = createColorTextureAttachment(reflectionBufferWidth, reflectionBufferHeight);
     reflectionDepthBuffer = createDepthBufferAttachment(reflectionBufferWidth, reflectionBufferHeight);
-    unbindReflectionFrameBuffer(window); 
+    unbindReflectionFrameBuffer(surface); 
 }
 
-void WaterFrameBuffer::initRefractionFrameBuffer(GLFWwindow* window)
+inline void WaterFrameBuffer::initRefractionFrameBuffer(const Surface* surface)
 {
     glGenFramebuffers(1, &refractionFrameBuffer);
     bindRefractionFrameBuffer();
     refractionColorTexture = createColorTextureAttachment(refractionBufferWidth, refractionBufferHeight);
     refractionDepthTexture = createDepthTextureAttachment(refractionBufferWidth, refractionBufferHeight);
-    unbindReflectionFrameBuffer(window); 
+    unbindReflectionFrameBuffer(surface); 
 }
 
-GLuint WaterFrameBuffer::createColorTextureAttachment(int width, int height)
+inline GLuint WaterFrameBuffer::createColorTextureAttachment(int width, int height)
 {
     GLuint texture;
     glGenTextures(1, &texture);
@@ -89,7 +125,7 @@ GLuint WaterFrameBuffer::createColorTextureAttachment(int width, int height)
     return texture;
 }
 
-GLuint WaterFrameBuffer::createDepthTextureAttachment(int width, int height)
+inline GLuint WaterFrameBuffer::createDepthTextureAttachment(int width, int height)
 {
     GLuint texture;
     glGenTextures(1, &texture);
@@ -101,68 +137,93 @@ GLuint WaterFrameBuffer::createDepthTextureAttachment(int width, int height)
     return texture;
 }
 
-GLuint WaterFrameBuffer::createDepthBufferAttachment(int width, int height)
+inline GLuint WaterFrameBuffer::createDepthBufferAttachment(int width, int height)
 {
     GLuint buffer;
     glGenRenderbuffers(1, &buffer);
     glBindRenderbuffer(GL_RENDERBUFFER, buffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, reflectionBufferWidth, reflectionBufferHeight);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, buffer);
     return buffer;
 }
 
-void WaterFrameBuffer::bindReflectionFrameBuffer()
+inline bool WaterFrameBuffer::resize(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if ((unsigned int)width == reflectionBufferWidth && (unsigned int)height == reflectionBufferHeight
+        && (unsigned int)width == refractionBufferWidth && (unsigned int)height == refractionBufferHeight)
+        return false;
+
+    reflectionBufferWidth = refractionBufferWidth = width;
+    reflectionBufferHeight = refractionBufferHeight = height;
+
+    // respecify the storage of the existing attachments, the framebuffers stay complete
+    glBindTexture(GL_TEXTURE_2D, reflectionColorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glBindRenderbuffer(GL_RENDERBUFFER, reflectionDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+
+    glBindTexture(GL_TEXTURE_2D, refractionColorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, refractionDepthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    return true;
+}
+
+inline void WaterFrameBuffer::bindReflectionFrameBuffer()
 {
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, reflectionFrameBuffer);
     glViewport(0, 0, reflectionBufferWidth, reflectionBufferHeight);
 }
 
-void WaterFrameBuffer::unbindReflectionFrameBuffer(GLFWwindow* window)
+inline void WaterFrameBuffer::unbindReflectionFrameBuffer(const Surface* surface)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    int fWidth, fHeight;
-    glfwGetFramebufferSize(window, &fWidth, &fHeight);
-    glViewport(0,0,fWidth,fHeight);
+    surface->bindFramebuffer();
 }
 
-void WaterFrameBuffer::bindRefractionFrameBuffer()
+inline void WaterFrameBuffer::bindRefractionFrameBuffer()
 {
     glBindTexture(GL_TEXTURE_2D, 0);
     glBindFramebuffer(GL_FRAMEBUFFER, refractionFrameBuffer);
     glViewport(0, 0, refractionBufferWidth, refractionBufferHeight);
 }
 
-void WaterFrameBuffer::unbindRefractionFrameBuffer(GLFWwindow* window)
+inline void WaterFrameBuffer::unbindRefractionFrameBuffer(const Surface* surface)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    int fWidth, fHeight;
-    glfwGetFramebufferSize(window, &fWidth, &fHeight);
-    glViewport(0,0,fWidth,fHeight);
+    surface->bindFramebuffer();
 }
 
-GLuint WaterFrameBuffer::getReflectionColorTexture() const
+inline GLuint WaterFrameBuffer::getReflectionColorTexture() const
 {
     return reflectionColorTexture;
 }
 
-GLuint WaterFrameBuffer::getRefractionColorTexture() const
+inline GLuint WaterFrameBuffer::getRefractionColorTexture() const
 {
     return refractionColorTexture;
 }
 
-GLuint WaterFrameBuffer::getRefractionDepthTexture() const
+inline GLuint WaterFrameBuffer::getRefractionDepthTexture() const
 {
     return refractionDepthTexture;
 }
 
-void WaterFrameBuffer::destroyReflectionFrameBuffer()
+inline void WaterFrameBuffer::destroyReflectionFrameBuffer()
 {
+    glDeleteTextures(1, &reflectionColorTexture);
+    glDeleteRenderbuffers(1, &reflectionDepthBuffer);
     glDeleteFramebuffers(1, &reflectionFrameBuffer);
 }
 
-void WaterFrameBuffer::destroyRefractionFrameBuffer()
+inline void WaterFrameBuffer::destroyRefractionFrameBuffer()
 {
+    glDeleteTextures(1, &refractionColorTexture);
+    glDeleteTextures(1, &refractionDepthTexture);
     glDeleteFramebuffers(1, &refractionFrameBuffer);
 }
 #endif // WATER_FBO_H
\ No newline at end of file
@@ -0,0 +1,119 @@
+#ifndef WATER_GROUP_H
+#define WATER_GROUP_H
+
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+#include "glm/glm.hpp"
+
+#include "Water/Water.hpp"
+#include "Water/WaterUpdatePolicy.hpp"
+
+/**
+ * Waters lying on the same plane, e.g. the tiles of one lagoon. They all see the same
+ * reflected and refracted scene, so a group renders a single reflection and refraction
+ * pass into a WaterFrameBuffer shared by every member, and adding patches to a plane
+ * costs little more than drawing their quads.
+ *
+ * Holds pointers into Scene::waters, which must not change while the groups are in use.
+ */
+struct WaterGroup {
+    glm::vec4 plane;
+    std::vector<Water*> members;
+
+    float scale = 1.0f;                 // current resolution scale of the shared targets
+    WaterRefreshState refresh;
+
+    // union of the members' footprints in normalized device coordinates
+    glm::vec2 screenMin = glm::vec2(FLT_MAX);
+    glm::vec2 screenMax = glm::vec2(-FLT_MAX);
+    float coverage = 0.0f;              // fraction of the screen covered by the members
+
+    WaterFrameBuffer* frameBuffer() const {
+        return members.front()->getWaterFrameBuffer();
+    }
+
+    bool onScreen() const {
+        return screenMin.x <= screenMax.x;
+    }
+
+    /* Recompute the screen bounds and coverage for the main camera */
+    void updateScreenBounds(const glm::mat4& viewProjection) {
+        screenMin = glm::vec2(FLT_MAX);
+        screenMax = glm::vec2(-FLT_MAX);
+        coverage = 0.0f;
+        for (const Water* water : members) {
+            for (const glm::vec2& p : water->screenFootprint(viewProjection)) {
+                screenMin = glm::min(screenMin, p);
+                screenMax = glm::max(screenMax, p);
+            }
+            coverage += water->screenCoverage(viewProjection);
+        }
+        coverage = std::min(coverage, 1.0f);
+    }
+
+    /**
+     * @brief Pixel rectangle of the shared targets the members cover when seen through
+     * a pass camera, so the pass can be scissored to it.
+     *
+     * @param padding Extra margin in normalized device coordinates, e.g. for the
+     * distortion the water shader applies when sampling.
+     * @return false if no member is in view of the camera.
+     */
+    bool scissorRect(const glm::mat4& viewProjection, float padding, glm::ivec4& rect) const {
+        glm::vec2 lo(FLT_MAX), hi(-FLT_MAX);
+        for (const Water* water : members) {
+            for (const glm::vec2& p : water->screenFootprint(viewProjection)) {
+                lo = glm::min(lo, p);
+                hi = glm::max(hi, p);
+            }
+        }
+        if (lo.x > hi.x)
+            return false;
+
+        const WaterFrameBuffer* fbo = frameBuffer();
+        glm::vec2 size(fbo->width(), fbo->height());
+        lo = glm::clamp((lo - padding) * 0.5f + 0.5f, 0.0f, 1.0f) * size;
+        hi = glm::clamp((hi + padding) * 0.5f + 0.5f, 0.0f, 1.0f) * size;
+
+        // one texel of slack for bilinear filtering at the edges
+        glm::ivec2 x0 = glm::max(glm::ivec2(glm::floor(lo)) - 1, glm::ivec2(0));
+        glm::ivec2 x1 = glm::min(glm::ivec2(glm::ceil(hi)) + 1, glm::ivec2(size));
+        rect = glm::ivec4(x0, x1 - x0);
+        return rect.z > 0 && rect.w > 0;
+    }
+
+    /**
+     * @brief Group waters whose plane equations match within a tolerance, and point
+     * every member of a group at the first member's framebuffer.
+     */
+    static std::vector<WaterGroup> build(std::vector<Water>& waters, float tolerance = 1e-4f) {
+        std::vector<WaterGroup> groups;
+        for (Water& water : waters) {
+            glm::vec4 plane = water.getPlaneEquation();
+
+            auto coplanar = [&](const WaterGroup& g) {
+                return glm::dot(glm::vec3(g.plane), glm::vec3(plane)) > 1.0f - tolerance
+                    && std::abs(g.plane.w - plane.w) <= tolerance * std::max(1.0f, std::abs(plane.w));
+            };
+            auto it = std::find_if(groups.begin(), groups.end(), coplanar);
+
+            if (it == groups.end()) {
+                groups.emplace_back();
+                groups.back().plane = plane;
+                groups.back().members.push_back(&water);
+            } else {
+                water.setWaterFrameBuffer(it->members.front()->sharedWaterFrameBuffer());
+                it->members.push_back(&water);
+            }
+        }
+
+        for (size_t i = 0; i < groups.size(); i++)
+            groups[i].refresh.phase = i;
+        return groups;
+    }
+};
+
+#endif // WATER_GROUP_H
@@ -0,0 +1,121 @@
+#ifndef WATER_UPDATE_POLICY_H
+#define WATER_UPDATE_POLICY_H
+
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+
+#include "glm/glm.hpp"
+
+#include "Camera.hpp"
+
+/* What a water's reflection/refraction textures were last rendered with */
+struct WaterRefreshState {
+    bool valid = false;             // false until first rendered, and after a resize
+    unsigned int phase = 0;         // staggers waters so they do not all refresh on the same frame
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::vec3 cameraFront = glm::vec3(0.0f);
+    float cameraFov = 0.0f;
+    float sceneMotion = 0.0f;       // upper bound on how far any object moved since then
+};
+
+/**
+ * Decides when the reflection and refraction textures of a water are re-rendered.
+ * Between refreshes the water shader reprojects the stale textures with the camera
+ * they were rendered from, so ripples stay attached to the surface.
+ *
+ *  EveryFrame    both textures every frame (the default)
+ *  Alternate     reflection on even frames, refraction on odd frames
+ *  EveryNFrames  both textures every N frames
+ *  OnMotion      both textures once the camera or any object moved past a threshold
+ */
+class WaterUpdatePolicy
+{
+    public:
+        enum Mode {
+            EveryFrame,
+            Alternate,
+            EveryNFrames,
+            OnMotion
+        };
+
+        WaterUpdatePolicy(Mode mode = EveryFrame, unsigned int interval = 3,
+                          float moveThreshold = 0.005f, float turnThresholdDegrees = 0.5f)
+            : _mode(mode), _interval(std::max(interval, 1u)),
+              _moveThreshold(moveThreshold), _turnThreshold(turnThresholdDegrees) {}
+
+        /**
+         * @brief Parse "always", "alternate", "every:N" or "motion[:DISTANCE]".
+         * @return false, leaving the policy unchanged, if the string is not recognised.
+         */
+        bool parse(const std::string& s) {
+            if (s == "always") {
+                _mode = EveryFrame;
+            } else if (s == "alternate") {
+                _mode = Alternate;
+            } else if (s.rfind("every:", 0) == 0 && std::atoi(s.c_str() + 6) > 0) {
+                _mode = EveryNFrames;
+                _interval = std::atoi(s.c_str() + 6);
+            } else if (s == "motion") {
+                _mode = OnMotion;
+            } else if (s.rfind("motion:", 0) == 0) {
+                _mode = OnMotion;
+                _moveThreshold = std::atof(s.c_str() + 7);
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Decide which textures to render this frame. Call rendered() once the
+         * passes are drawn.
+         *
+         * @param sceneMotion Largest object displacement this frame, see TransformStore.
+         */
+        void decide(WaterRefreshState& state, unsigned long frame, const Camera& camera, float sceneMotion,
+                    bool& renderReflection, bool& renderRefraction) const {
+            state.sceneMotion += sceneMotion;
+
+            if (!state.valid || _mode == EveryFrame) {
+                renderReflection = renderRefraction = true;
+            } else if (_mode == Alternate) {
+                renderReflection = (frame + state.phase) % 2 == 0;
+                renderRefraction = !renderReflection;
+            } else if (_mode == EveryNFrames) {
+                renderReflection = renderRefraction = (frame + state.phase) % _interval == 0;
+            } else {
+                float cosTurn = glm::dot(camera.getFront(), state.cameraFront);
+                bool moved = glm::length(camera.getPosition() - state.cameraPosition) > _moveThreshold
+                          || cosTurn < std::cos(glm::radians(_turnThreshold))
+                          || camera.getFov() != state.cameraFov
+                          || state.sceneMotion > _moveThreshold;
+                renderReflection = renderRefraction = moved;
+            }
+        }
+
+        /**
+         * @brief Record the textures that were actually rendered this frame. The state
+         * becomes valid only once both were, so a pass skipped after decide(), e.g.
+         * because the water is out of that camera's view, is asked for again.
+         */
+        void rendered(WaterRefreshState& state, const Camera& camera,
+                      bool renderedReflection, bool renderedRefraction) const {
+            if (renderedReflection && renderedRefraction) {
+                state.valid = true;
+                state.cameraPosition = camera.getPosition();
+                state.cameraFront = camera.getFront();
+                state.cameraFov = camera.getFov();
+                state.sceneMotion = 0.0f;
+            }
+        }
+
+    private:
+        Mode _mode;
+        unsigned int _interval;
+        float _moveThreshold;
+        float _turnThreshold;
+};
+
+#endif // WATER_UPDATE_POLICY_H
@@ -1,6 +1,7 @@
 #version 410 core
 
-in vec4 clipSpace;
+in vec4 reflectionClipSpace;
+in vec4 refractionClipSpace;
 in vec2 dudvTexCoords;
 in vec3 fragPos;
 out vec4 FragColor;
@@ -23,16 +24,15 @@ float ndcToWorldDepth(float depth, float nearPlane, float farPlane)
 
 void main()
 {
-    vec2 ndc = clipSpace.xy / clipSpace.w;
-    ndc = (ndc + 1) * 0.5f;
-
-    vec2 reflectTexCoord = vec2(1 - ndc.x, ndc.y);
-    vec2 refractTexCoord = ndc;
+    // project the surface point with the cameras the textures were rendered with; the
+    // reflected camera mirrors x, so no flip is needed here
+    vec2 reflectTexCoord = (reflectionClipSpace.xy / reflectionClipSpace.w + 1) * 0.5f;
+    vec2 refractTexCoord = (refractionClipSpace.xy / refractionClipSpace.w + 1) * 0.5f;
 
     float totalDepth = texture(depthTexture, refractTexCoord).x;
     totalDepth = ndcToWorldDepth(totalDepth, nearPlane, farPlane);
 
-    float fragDepth = ndcToWorldDepth(gl_FragCoord.z, nearPlane, farPlane);
+    float fragDepth = refractionClipSpace.w;   // view depth in the refraction camera
     float waterDepth = totalDepth - fragDepth;
 
     float depthCutoff = 0.1f;
@@ -2,18 +2,27 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPos;
+};
 
-out vec4 clipSpace;       // clip space coordinates of vertex
+// cameras the reflection and refraction textures were rendered with (may be older frames)
+uniform mat4 reflectionViewProjection;
+uniform mat4 refractionViewProjection;
+
+out vec4 reflectionClipSpace;   // clip space coordinates of vertex in the texture cameras
+out vec4 refractionClipSpace;
 out vec3 fragPos;
 out vec2 dudvTexCoords;
 
 void main()
 {
     fragPos = (view * vec4(aPos, 1.0f)).xyz;
-    clipSpace = projection * view * vec4(aPos, 1.0f);
-    gl_Position = clipSpace;
+    gl_Position = projection * view * vec4(aPos, 1.0f);
+    reflectionClipSpace = reflectionViewProjection * vec4(aPos, 1.0f);
+    refractionClipSpace = refractionViewProjection * vec4(aPos, 1.0f);
     dudvTexCoords = aPos.xz;
 
 }
\ No newline at end of file
@@ -1,4 +1,8 @@
 #include <iostream>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -12,6 +16,8 @@
 #include <stb/stb_image.h>
 
 #include "Application.hpp"
+#include "Profiler.hpp"
+#include "CameraPath.hpp"
 #include "Shader.hpp"
 #include "Camera.hpp"
 #include "Water/Water.hpp"
@@ -20,21 +26,80 @@
 #include "Entity/Entity.hpp"
 #include "LightSource/LightSource.hpp"
 #include "Scene.hpp"
+#include "TextureLoader.hpp"
+#include "ResourceManager.hpp"
+#include "SceneStreamer.hpp"
+#include "CubeMapFile.hpp"
 
-Scene loadBoatScene(GLFWwindow* window)
+/**
+ * Add the water quad center +/- dx +/- dy to the scene, split into tiles x tiles
+ * coplanar patches (e.g. to check that extra patches do not add render passes).
+ */
+void addWater(Scene& scene, const Surface* surface, const glm::vec3& center, const glm::vec3& dx, const glm::vec3& dy, int tiles)
 {
-    Scene scene;
+    tiles = std::max(tiles, 1);
+    glm::vec3 tileDx = dx / float(tiles), tileDy = dy / float(tiles);
+    scene.waters.reserve(scene.waters.size() + tiles * tiles);
+    for (int i = 0; i < tiles; i++) {
+        for (int j = 0; j < tiles; j++) {
+            glm::vec3 tileCenter = center - dx - dy + float(2 * i + 1) * tileDx + float(2 * j + 1) * tileDy;
+            scene.waters.emplace_back(surface, tileCenter, tileDx, tileDy);
+        }
+    }
+}
+
+/* Rough world bounds of a streamed object, so it can be loaded before what is out of view */
+AABB placeholder(const glm::vec3& center, float radius)
+{
+    AABB box;
+    box.expand(center - glm::vec3(radius));
+    box.expand(center + glm::vec3(radius));
+    return box;
+}
 
+/**
+ * Scatter count small lantern lights over the sand around the boat, on a golden-angle
+ * spiral so any count covers the area evenly. Their short range makes each one cheap
+ * to shade deferred; the forward path only lights with the first few.
+ */
+void addLanterns(SceneStreamer& streamer, int count)
+{
+    const float goldenAngle = 2.39996323f;
+    const float spread = 1.2f;     // radius of the spiral
+    for (int i = 0; i < count; i++) {
+        float r = spread * std::sqrt((i + 0.5f) / count);
+        float angle = i * goldenAngle;
+        glm::vec3 position(r * std::cos(angle), 0.08f, -0.6f + r * std::sin(angle));
+
+        // warm, each a little different
+        float hue = 0.5f + 0.5f * std::sin(i * 1.7f);
+        glm::vec3 color = glm::mix(glm::vec3(250.0f, 152.0f, 32.0f), glm::vec3(255.0f, 200.0f, 120.0f), hue) / 255.0f;
+
+        streamer.addPointLight("../res/lantern/light.obj", [position, color](PointLight& pl) {
+            pl.setAmbient(color * .05f);
+            pl.setDiffuse(color * 0.8f);
+            pl.setSpecular(color);
+            pl.setLinear(8.0f);
+            pl.setQuadratic(2000.0f);   // out of range after about half a unit
+            pl.translate(position);
+            pl.scale(glm::vec3(0.0005f));
+        }, placeholder(position, 0.03f));
+    }
+}
+
+/* Entities and point lights are queued on streamer and appear as they finish loading */
+void loadBoatScene(Scene& scene, SceneStreamer& streamer, const Surface* surface, int waterTiles, int lanterns)
+{
     // create light sources
-    std::string pointLightPath = "../res/lantern/light.obj";
-    PointLight pl(pointLightPath); 
-    glm::vec3 warmLight = glm::vec3(250.0f, 152.0f, 32.0f) / 255.0f;
-    pl.setAmbient(warmLight * .05f);
-    pl.setDiffuse(warmLight * 0.8f);
-    pl.setSpecular(warmLight);
-    pl.translate(glm::vec3(0.0, 0.09f, -0.05f));
-    pl.scale(glm::vec3(0.001f));
-    scene.pointLights.push_back(pl);
+    streamer.addPointLight("../res/lantern/light.obj", [](PointLight& pl) {
+        glm::vec3 warmLight = glm::vec3(250.0f, 152.0f, 32.0f) / 255.0f;
+        pl.setAmbient(warmLight * .05f);
+        pl.setDiffuse(warmLight * 0.8f);
+        pl.setSpecular(warmLight);
+        pl.translate(glm::vec3(0.0, 0.09f, -0.05f));
+        pl.scale(glm::vec3(0.001f));
+    }, placeholder(glm::vec3(0.0, 0.09f, -0.05f), 0.05f));
+    addLanterns(streamer, lanterns);
 
     // create directional light
     DirLight dirLight;
@@ -45,48 +110,72 @@ Scene loadBoatScene(GLFWwindow* window)
     scene.dirLights.push_back(dirLight);
 
     // lantern
-    char lanternPath[] = "../res/lantern/OBJ.obj";
-    Entity lantern(lanternPath);
-    lantern.translate(glm::vec3(0.0, 0.09f, -0.05f));
-    lantern.scale(glm::vec3(0.001f));
-    scene.entities.push_back(lantern);
+    streamer.addEntity("../res/lantern/OBJ.obj", [](Entity& lantern) {
+        lantern.translate(glm::vec3(0.0, 0.09f, -0.05f));
+        lantern.scale(glm::vec3(0.001f));
+    }, placeholder(glm::vec3(0.0, 0.09f, -0.05f), 0.1f));
 
     // boat
-    char boatPath[] = "../res/oldboat/OldBoat.blend";
-    Entity boat(boatPath);
-    boat.translate(glm::vec3(0.0f, 0.05f, 0.05f));
-    boat.scale(glm::vec3(0.02f));
-    boat.rotateX(-90.0f);
-    scene.entities.push_back(boat);
+    streamer.addEntity("../res/oldboat/OldBoat.blend", [](Entity& boat) {
+        boat.translate(glm::vec3(0.0f, 0.05f, 0.05f));
+        boat.scale(glm::vec3(0.02f));
+        boat.rotateX(-90.0f);
+    }, placeholder(glm::vec3(0.0f, 0.05f, 0.05f), 0.5f));
 
     // sand
-    char sandPath[] = "../res/island/sand/quad.obj";
-    Entity sand(sandPath);
-    sand.scale(glm::vec3(3.0f));
-    sand.rotateX(92.5f);
-    sand.translate(glm::vec3(0.0f, 0.05f, -2.0f));
-    sand.setTexCoordScale(20.0f);
-    scene.entities.push_back(sand);
+    streamer.addEntity("../res/island/sand/quad.obj", [](Entity& sand) {
+        sand.scale(glm::vec3(3.0f));
+        sand.rotateX(92.5f);
+        sand.translate(glm::vec3(0.0f, 0.05f, -2.0f));
+        sand.setTexCoordScale(20.0f);
+    }, placeholder(glm::vec3(0.0f, 0.05f, -2.0f), 3.0f));
 
     // create skybox
     const std::string prefix = "../res/night_skybox/";
-    std::vector<std::string> faces = {
-        "px.png",
-        "nx.png",
-        "py.png",
-        "ny.png",
-        "pz.png",
-        "nz.png"
-    };
-
-    for (auto& f : faces)
-        f = prefix + f;
-    scene.skyBox = new Skybox(faces);
+    scene.skyBox = new Skybox(CubeMapFile::facePaths(prefix), prefix + "skybox.cubemap");
 
     // create water
     glm::vec3 center(0.0f, 0.0f, 0.0f), dx(100.0f, 0.0f, 0.0f), dy(0.0f, 0.0f, -100.0f);
-    scene.waters.emplace_back(window, center, dx, dy);
-    return scene;
+    addWater(scene, surface, center, dx, dy, waterTiles);
+}
+
+/**
+ * Stress scene for the instanced draw path: a grid of numTrees palm trees on the
+ * sand, all sharing one Model.
+ */
+void loadPalmBenchmarkScene(Scene& scene, SceneStreamer& streamer, const Surface* surface, int numTrees, int waterTiles)
+{
+    DirLight dirLight;
+    dirLight._direction = glm::vec3(0.0f, -1.0f, -0.2f);
+    dirLight._ambient = glm::vec3(0.2f);
+    dirLight._diffuse = glm::vec3(0.6f);
+    dirLight._specular = glm::vec3(0.3f);
+    scene.dirLights.push_back(dirLight);
+
+    streamer.addEntity("../res/island/sand/quad.obj", [](Entity& sand) {
+        sand.scale(glm::vec3(3.0f));
+        sand.rotateX(92.5f);
+        sand.translate(glm::vec3(0.0f, 0.05f, -2.0f));
+        sand.setTexCoordScale(20.0f);
+    }, placeholder(glm::vec3(0.0f, 0.05f, -2.0f), 3.0f));
+
+    // grid of trees in front of the camera
+    const std::string palmPath = "../res/island/Palm_Tree.obj";
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(numTrees))));
+    const float spacing = 0.08f;
+    scene.entities.reserve(scene.entities.size() + numTrees + 1);
+    for (int i = 0; i < numTrees; i++) {
+        int row = i / side, col = i % side;
+        glm::vec3 position((col - side / 2) * spacing, 0.1f, -row * spacing);
+        streamer.addEntity(palmPath, [i, position](Entity& palm) {
+            palm.scale(glm::vec3(0.02f));
+            palm.rotateY(static_cast<float>((i * 37) % 360));
+            palm.translate(position);
+        }, placeholder(position, 0.1f));
+    }
+
+    glm::vec3 center(0.0f, 0.0f, 0.0f), dx(100.0f, 0.0f, 0.0f), dy(0.0f, 0.0f, -100.0f);
+    addWater(scene, surface, center, dx, dy, waterTiles);
 }
 
 /*
@@ -124,18 +213,187 @@ Scene loadLuxoScene()
     return scene;
 }*/
 
-int main() 
+/**
+ * Usage: main [--bench-palms N] [--frames N] [--no-instancing] [--water-budget MS]
+ *             [--water-refresh MODE] [--water-tiles N] [--profile] [--trace FILE] [--headless]
+ *             [--record FILE] [--replay FILE] [--sync-load] [--packed-vertices] [--no-lod]
+ *             [--water-lod-bias PX] [--uncompressed-textures] [--transcode-textures]
+ *             [--pack-skybox DIR] [--deferred] [--lanterns N]
+ *
+ *  --bench-palms N   load the palm tree benchmark scene with N trees instead of the boat scene
+ *  --frames N        exit after N frames and print the average CPU frame time
+ *  --no-instancing   draw every entity with its own draw call
+ *  --water-budget MS frame time the water reflection resolution is scaled to meet
+ *  --water-refresh MODE  when water reflections are re-rendered: always (default),
+ *                    alternate, every:N or motion[:DISTANCE]
+ *  --water-tiles N   split the water into N x N coplanar patches
+ *  --profile         print CPU profiler zone averages every two seconds and on exit
+ *  --trace FILE      write the profiled zones as a Chrome trace (chrome://tracing) on exit
+ *  --headless        render offscreen without a window, e.g. on machines without a display
+ *                    or GPU; runs 1000 frames unless --frames is given
+ *  --record FILE     save the camera flight and frame times to FILE on exit
+ *  --replay FILE     fly the camera along a recorded path at a fixed timestep, so every
+ *                    replay renders the same frames; stops at the end of the path
+ *  --sync-load       load the whole scene before the first frame instead of streaming it
+ *                    in; implied by --frames, --headless and --replay to keep their timings comparable
+ *  --packed-vertices store mesh vertices quantized in 20 instead of 56 bytes
+ *  --no-lod          draw every mesh at full detail
+ *  --water-lod-bias PX  screen-space error in pixels accepted in the reflection and
+ *                    refraction passes when picking levels of detail (default 2)
+ *  --uncompressed-textures  keep model textures at 4 bytes per texel instead of BC1/BC3/BC5
+ *  --transcode-textures  compress the scene's textures into their .texcache files and exit
+ *  --pack-skybox DIR pack DIR/{px,nx,py,ny,pz,nz}.png with their mips into DIR/skybox.cubemap,
+ *                    BC1 compressed unless --uncompressed-textures is given, and exit
+ *  --deferred        shade entities from a G-buffer, lit by every point light in view
+ *  --lanterns N      add N small lantern lights around the boat
+ */
+int main(int argc, char** argv) 
 {
+    int benchPalms = 0;
+    unsigned long frameLimit = 0;
+    bool instancing = true;
+    float waterBudgetMs = 1000.0f / 60.0f;
+    WaterUpdatePolicy waterPolicy;
+    int waterTiles = 1;
+    bool profile = false;
+    std::string tracePath;
+    bool headless = false;
+    std::string recordPath, replayPath;
+    bool syncLoad = false;
+    bool lod = true;
+    float waterLodBias = 2.0f;
+    bool compressTextures = true;
+    bool transcodeOnly = false;
+    std::string packSkyboxDir;
+    bool deferred = false;
+    int lanterns = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench-palms" && i + 1 < argc)
+            benchPalms = std::atoi(argv[++i]);
+        else if (arg == "--frames" && i + 1 < argc)
+            frameLimit = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--no-instancing")
+            instancing = false;
+        else if (arg == "--no-lod")
+            lod = false;
+        else if (arg == "--water-lod-bias" && i + 1 < argc)
+            waterLodBias = std::atof(argv[++i]);
+        else if (arg == "--uncompressed-textures")
+            compressTextures = false;
+        else if (arg == "--transcode-textures")
+            transcodeOnly = true;
+        else if (arg == "--pack-skybox" && i + 1 < argc)
+            packSkyboxDir = argv[++i];
+        else if (arg == "--deferred")
+            deferred = true;
+        else if (arg == "--lanterns" && i + 1 < argc)
+            lanterns = std::atoi(argv[++i]);
+        else if (arg == "--packed-vertices")
+            Mesh::setVertexFormat(VertexFormat::Packed);
+        else if (arg == "--water-budget" && i + 1 < argc)
+            waterBudgetMs = std::atof(argv[++i]);
+        else if (arg == "--water-tiles" && i + 1 < argc)
+            waterTiles = std::atoi(argv[++i]);
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--sync-load")
+            syncLoad = true;
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--profile")
+            profile = true;
+        else if (arg == "--trace" && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (arg == "--water-refresh" && i + 1 < argc) {
+            if (!waterPolicy.parse(argv[++i]))
+                std::cout << "Ignoring unknown water refresh mode " << argv[i] << std::endl;
+        }
+        else
+            std::cout << "Ignoring unknown argument " << arg << std::endl;
+    }
+
+    // offline conversion, needs no window
+    if (!packSkyboxDir.empty()) {
+        std::string packedPath = (std::filesystem::path(packSkyboxDir) / "skybox.cubemap").string();
+        if (!CubeMapFile::pack(CubeMapFile::facePaths(packSkyboxDir), packedPath, compressTextures))
+            return 1;
+        std::cout << "Packed " << packedPath << std::endl;
+        return 0;
+    }
+
+    // enable before anything starts, so loading and the texture workers are profiled too
+    Profiler::instance().setEnabled(profile || !tracePath.empty());
+    Profiler::instance().setThreadName("main");
     
-    Application app(800, 600);
+    CameraPath cameraPath;
+    if (!replayPath.empty() && !cameraPath.load(replayPath))
+        return 1;
+
+    // a headless run has no window to close
+    if (headless && frameLimit == 0 && replayPath.empty())
+        frameLimit = 1000;
+
+    Application app(800, 600, headless);
+    if (!app.surface())
+        return 1;
+    app.setFrameLimit(frameLimit);
+    TextureLoader::instance().setCompression(compressTextures || transcodeOnly);
+    app.setInstancing(instancing);
+    app.setWaterFrameBudget(waterBudgetMs);
+    app.setWaterUpdatePolicy(waterPolicy);
+    app.setLodEnabled(lod);
+    app.setLodBias(ReflectionPass, waterLodBias);
+    app.setLodBias(RefractionPass, waterLodBias);
+    app.setDeferred(deferred);
+    if (profile)
+        app.setProfileReportInterval(2.0f);
+    if (!replayPath.empty())
+        app.replayCameraPath(&cameraPath);
+    else if (!recordPath.empty())
+        app.recordCameraPath(&cameraPath);
+
     Camera camera(glm::vec3(0.0f, 0.3f,-2.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     camera.setMoveSensitivity(0.01f);
-    Scene scene = loadBoatScene(app.window());
+
+    Scene scene;
+    SceneStreamer streamer(scene);
+    if (benchPalms > 0)
+        loadPalmBenchmarkScene(scene, streamer, app.surface(), benchPalms, waterTiles);
+    else
+        loadBoatScene(scene, streamer, app.surface(), waterTiles, lanterns);
+
+    // measured runs render the complete scene from the first frame
+    syncLoad = syncLoad || frameLimit > 0 || !replayPath.empty() || transcodeOnly;
+    if (syncLoad) {
+        streamer.finish();
+        TextureLoader::instance().printReport();
+        ResourceManager::instance().printStats();
+    }
+
+    // the caches are written as the textures load
+    if (transcodeOnly)
+        return 0;
 
     app.attachScene(scene);
     app.attachCamera(camera);
+    if (!syncLoad)
+        app.attachStreamer(&streamer);
     
     app.run();
 
+    if (!syncLoad) {
+        TextureLoader::instance().printReport();
+        ResourceManager::instance().printStats();
+    }
+
+    if (!recordPath.empty() && replayPath.empty())
+        cameraPath.save(recordPath);
+
+    if (!tracePath.empty())
+        Profiler::instance().writeChromeTrace(tracePath);
+
     return 0;
 }
\ No newline at end of file